@@ -20,6 +20,9 @@
  */
 #include <avr/interrupt.h>
 
+/* The host build (see host/) provides its own versions */
+#ifndef HOST_BUILD
+
 #undef ISR
 /**
  * @brief  Synthos does not support variadic macros yet
@@ -47,3 +50,5 @@ static void inline cli (void) __attribute__ ((always_inline));
 static void inline cli (void) {
     __asm__ __volatile__ ("cli" ::: "memory");
 }
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Augmentation for avr/pgmspace.h
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * The string literals and the other initialized constants are copied
+ * to SRAM at startup unless they are placed in flash with PROGMEM
+ * (PSTR for the literals). Flash has its own address space, the data
+ * there are read with pgm_read_xxx.
+ */
+#ifndef AUG_PGMSPACE_H
+#define AUG_PGMSPACE_H
+
+#include <avr/pgmspace.h>
+
+/* The host build (see host/) provides its own versions */
+#ifndef HOST_BUILD
+
+#undef pgm_read_byte
+/**
+ * @brief  Synthos does not support yet the statement expressions
+ *         avr-libc uses here
+ */
+static uint8_t inline pgm_read_byte (const void * p) __attribute__ ((always_inline));
+static uint8_t inline pgm_read_byte (const void * p) {
+    uint8_t r;
+
+    __asm__ ("lpm %0, Z" : "=r" (r) : "z" (p));
+    return r;
+}
+
+#undef pgm_read_word
+/**
+ * @brief  Synthos does not support yet the statement expressions
+ *         avr-libc uses here
+ */
+static uint16_t inline pgm_read_word (const void * p) __attribute__ ((always_inline));
+static uint16_t inline pgm_read_word (const void * p) {
+    uint16_t r;
+
+    __asm__ ("lpm %A0, Z+\n\t"
+             "lpm %B0, Z" : "=r" (r), "+z" (p));
+    return r;
+}
+
+#undef pgm_read_dword
+/**
+ * @brief  Synthos does not support yet the statement expressions
+ *         avr-libc uses here
+ */
+static uint32_t inline pgm_read_dword (const void * p) __attribute__ ((always_inline));
+static uint32_t inline pgm_read_dword (const void * p) {
+    uint32_t r;
+
+    __asm__ ("lpm %A0, Z+\n\t"
+             "lpm %B0, Z+\n\t"
+             "lpm %C0, Z+\n\t"
+             "lpm %D0, Z" : "=r" (r), "+z" (p));
+    return r;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Augmentation for avr/sleep.h
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ */
+#include <avr/sleep.h>
+
+/* The host build (see host/) provides its own version */
+#ifndef HOST_BUILD
+
+#undef sleep_cpu
+/**
+ * @brief Synthos does not suport correctly yet function-style macros
+ *        without arguments
+ */
+static void inline sleep_cpu (void) __attribute__ ((always_inline));
+static void inline sleep_cpu (void) {
+    __asm__ __volatile__ ("sleep" ::: "memory");
+}
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Remote control command channel
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * The frame format is in command.h. A motion or pan command takes
+ * the rover away from robot () until command_auto comes.
+ */
+#include "aug-interrupt.h"
+
+#include "events.h"
+#include "timer.h"
+#include "uart.h"
+#include "hardware.h"
+#include "motors.h"
+#include "robot.h"
+#include "telemetry.h"
+#include "command.h"
+
+/* Request being received */
+static uint8_t command_frame [command_request_max], command_length, command_escape, command_overflow;
+
+unsigned command_errors;
+uint16_t command_latency_max;
+
+/**
+ * @brief  What makes a command take effect
+ */
+typedef enum {
+    command_effect_reply,   /* the reply itself */
+    command_effect_motors,  /* the motor tasks, see motors_applied */
+    command_effect_pan      /* the first pulse of the pan servo, see pan_started */
+} command_effect_type;
+
+/* When the last command took effect, see timer_us */
+static uint32_t command_effect_time;
+
+/**
+ * @brief  Takes a received byte into the request
+ * @param  b  byte
+ * @return  request length without the CRC once a good request is in, 0 otherwise
+ */
+static uint8_t command_take (uint8_t b) {
+    uint16_t crc;
+    uint8_t n, i;
+
+    if (b == command_slip_end) {
+        n = command_length;
+        command_length = command_escape = 0;
+        if (command_overflow) {
+            command_overflow = 0;
+            command_errors ++;
+            return 0;
+        }
+        /* Nothing since the previous END */
+        if (n == 0)
+            return 0;
+        crc = 0xFFFF;
+        for (i = 0; i < n; i ++)
+            crc = command_crc (crc, command_frame [i]);
+        if (n < 4 || crc != 0) {
+            command_errors ++;
+            return 0;
+        }
+        return n - 2;
+    }
+    if (b == command_slip_esc) {
+        command_escape = 1;
+        return 0;
+    }
+    if (command_escape) {
+        command_escape = 0;
+        if (b == command_slip_esc_end)
+            b = command_slip_end;
+        else if (b == command_slip_esc_esc)
+            b = command_slip_esc;
+    }
+    if (command_length < command_request_max)
+        command_frame [command_length ++] = b;
+    else
+        command_overflow = 1;
+    return 0;
+}
+
+/**
+ * @brief  Puts a byte into a SLIP frame
+ * @param  buf  frame
+ * @param  n  frame length so far
+ * @param  b  byte
+ * @return  new frame length
+ */
+static uint8_t command_put (uint8_t * buf, uint8_t n, uint8_t b) {
+    if (b == command_slip_end) {
+        buf [n ++] = command_slip_esc;
+        b = command_slip_esc_end;
+    } else if (b == command_slip_esc) {
+        buf [n ++] = command_slip_esc;
+        b = command_slip_esc_esc;
+    }
+    buf [n ++] = b;
+    return n;
+}
+
+/**
+ * @brief  Makes a frame
+ * @param  buf  where to put it, 2 * count + 6 bytes
+ * @param  data  frame contents
+ * @param  count  number of bytes of the contents
+ * @return  frame length
+ *
+ * Adds the CRC and the SLIP framing (see command.h).
+ */
+uint8_t command_encode (uint8_t * buf, const uint8_t * data, uint8_t count) {
+    uint16_t crc = 0xFFFF;
+    uint8_t n = 0, i;
+
+    buf [n ++] = command_slip_end;
+    for (i = 0; i < count; i ++) {
+        crc = command_crc (crc, data [i]);
+        n = command_put (buf, n, data [i]);
+    }
+    n = command_put (buf, n, (uint8_t) (crc >> 8));
+    n = command_put (buf, n, (uint8_t) crc);
+    buf [n ++] = command_slip_end;
+    return n;
+}
+
+/**
+ * @brief  Makes the reply to the request in command_frame
+ * @param  buf  where to put it, 2 * command_reply_max + 2 bytes
+ * @param  status  status
+ * @param  latency  latency in us
+ * @param  value  value
+ * @param  count  number of bytes of the value to send, 0 or 2
+ * @return  reply length
+ */
+static uint8_t command_reply (uint8_t * buf, uint8_t status, uint16_t latency,
+                              uint16_t value, uint8_t count) {
+    uint8_t data [command_reply_max - 2];
+
+    data [0] = command_frame [0];
+    data [1] = command_frame [1] | command_reply_flag;
+    data [2] = status;
+    data [3] = (uint8_t) latency;
+    data [4] = (uint8_t) (latency >> 8);
+    data [5] = (uint8_t) value;
+    data [6] = (uint8_t) (value >> 8);
+    return command_encode (buf, data, 5 + count);
+}
+
+/**
+ * @brief  Takes the rover from robot ()
+ */
+static void command_remote (void) {
+    if (! robot_remote) {
+        robot_remote = 1;
+        /* The whole range is of interest now */
+        ultrasonic_set_range (0);
+    }
+}
+
+/**
+ * @brief  Command channel task
+ *
+ * Reads the UART and carries out the requests as they come. The
+ * latency is counted from the arrival of the last byte of the
+ * request to the moment the rover acts on it: both motor tasks have
+ * set the new direction and torque, or the first pulse with the new
+ * pan position has gone out (the servos are refreshed from the 10 ms
+ * tick). So it includes the time the tasks take to wake up.
+ */
+void command () {
+    uint8_t input [8], reply [2 + 2 * command_reply_max], n, i, length, status, count, last, sreg, effect;
+    uint16_t arg, value, latency;
+    uint32_t received;
+
+    for (;;) {
+        uart_read (n, input, sizeof (input));
+        for (i = 0; i < n; i ++) {
+            length = command_take (input [i]);
+            if (length == 0)
+                continue;
+
+            sreg = SREG;
+            cli ();
+            received = uart_receive_time;
+            SREG = sreg;
+            last = i == n - 1 && uart_receive_count () == 0;
+
+            arg = length == 4 ? command_frame [2] | command_frame [3] << 8 : 0;
+            status = command_ok;
+            value = 0;
+            count = 0;
+            effect = command_effect_reply;
+            if (command_frame [1] == command_pan) {
+                if (length != 4 || arg < robot_pan_min || arg > robot_pan_max)
+                    status = command_bad;
+                else {
+                    command_remote ();
+                    robot_pan (arg);
+                    effect = command_effect_pan;
+                }
+            } else if (command_frame [1] == command_telemetry) {
+                if (length != 4)
+                    status = command_bad;
+                else
+                    telemetry_set_period (arg);
+            } else if (length != 2)
+                status = command_bad;
+            else
+                switch (command_frame [1]) {
+                  case command_stop:
+                    command_remote ();
+                    motors_stop ();
+                    effect = command_effect_motors;
+                    break;
+                  case command_forward:
+                    command_remote ();
+                    motors_forward ();
+                    effect = command_effect_motors;
+                    break;
+                  case command_backward:
+                    command_remote ();
+                    motors_backward ();
+                    effect = command_effect_motors;
+                    break;
+                  case command_left:
+                    command_remote ();
+                    motors_left ();
+                    effect = command_effect_motors;
+                    break;
+                  case command_right:
+                    command_remote ();
+                    motors_right ();
+                    effect = command_effect_motors;
+                    break;
+                  case command_range:
+                    if (robot_remote) {
+                        /* The sensor has one waiter at a time, robot ()
+                           has to be done with it */
+                        SynthOS_wait (robot_parked);
+                        value = SynthOS_call (ultrasonic_measure ());
+                    } else {
+                        /* robot () keeps the rover and measures for us */
+                        robot_range_wanted = 1;
+                        SynthOS_wait (! robot_range_wanted);
+                        value = robot_range_value;
+                    }
+                    count = 2;
+                    break;
+                  case command_auto:
+                    robot_remote = 0;
+                    break;
+                  default:
+                    status = command_bad;
+                }
+
+            if (effect == command_effect_motors)
+                SynthOS_wait (motors_applied (&command_effect_time));
+            else if (effect == command_effect_pan)
+                SynthOS_wait (pan_started (&command_effect_time));
+            else
+                command_effect_time = timer_us ();
+
+            latency = command_latency_unknown;
+            if (last) {
+                received = (int32_t) (command_effect_time - received) > 0 ? command_effect_time - received : 0;
+                latency = received < command_latency_unknown ? (uint16_t) received : command_latency_unknown - 1;
+                if (latency > command_latency_max)
+                    command_latency_max = latency;
+            }
+            length = command_reply (reply, status, latency, value, count);
+            uart_write (reply, length);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Remote control command channel interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Commands come in over the UART as SLIP frames (RFC 1055): a frame
+ * ends with command_slip_end, and the END and ESC bytes inside it are
+ * sent as ESC ESC_END and ESC ESC_ESC. The senders start frames with
+ * an END too, which flushes whatever noise came before. A request is
+ *
+ *     sequence, code, [argument low, argument high], CRC high, CRC low
+ *
+ * and every good request is answered with
+ *
+ *     sequence, code | command_reply_flag, status,
+ *     latency low, latency high, [value low, value high], CRC high, CRC low
+ *
+ * The CRC is CRC-16/CCITT (polynomial 0x1021, starting from 0xFFFF)
+ * of all the bytes before it, so the CRC of a whole good frame is 0.
+ * Frames with a bad CRC are counted in command_errors and not
+ * answered, the sender retries. The latency is the time in us from
+ * the end of the request to the moment the command took effect: the
+ * motor tasks have put the new motion on the motors, or the first pulse
+ * with the new pan position has started (command_latency_unknown if
+ * more data came in meanwhile). The replies go out after that.
+ *
+ * The replies share the UART with the print output and the telemetry
+ * frames (see telemetry.h, their second byte is below
+ * command_reply_flag); the text between the frames does not pass for
+ * a frame because of the CRC.
+ *
+ * This header is also used by the host client (host/cmdlink.c).
+ */
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+
+/** @brief  Commands */
+typedef enum {
+    command_stop = 1,
+    command_forward,
+    command_backward,
+    command_left,
+    command_right,
+    command_pan,       /* argument: pan pulse time in us */
+    command_range,     /* value: distance in cm or ultrasonic_clear, ungated */
+    command_auto,      /* back to the scanning of robot () */
+    command_telemetry  /* argument: telemetry period in ms, 0 - off (see telemetry.h) */
+} command_code_type;
+
+/** @brief  Reply status */
+typedef enum {
+    command_ok = 0,
+    command_bad          /* unknown command or bad argument */
+} command_status_type;
+
+#define command_reply_flag      0x80
+#define command_latency_unknown 0xFFFF
+
+#define command_slip_end     0xC0
+#define command_slip_esc     0xDB
+#define command_slip_esc_end 0xDC
+#define command_slip_esc_esc 0xDD
+
+/** @brief  Longest request, CRC included */
+#define command_request_max 6
+
+/** @brief  Longest reply, CRC included */
+#define command_reply_max 9
+
+/**
+ * @brief  Adds a byte to CRC-16/CCITT
+ * @param  crc  CRC so far, 0xFFFF to start
+ * @param  b  byte
+ * @return  new CRC
+ */
+static inline uint16_t command_crc (uint16_t crc, uint8_t b) {
+    crc = (uint16_t) (crc >> 8 | crc << 8) ^ b;
+    crc ^= (uint8_t) crc >> 4;
+    crc ^= (uint16_t) (crc << 12);
+    crc ^= (uint16_t) ((uint8_t) crc << 5);
+    return crc;
+}
+
+extern unsigned command_errors;
+extern uint16_t command_latency_max;
+
+uint8_t command_encode (uint8_t * buf, const uint8_t * data, uint8_t count);
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Event flags
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ */
+#include "events.h"
+
+/** @brief Event flags, set by the sources and cleared by the waiters */
+volatile uint8_t events [events_count];
+
+#ifdef EVENT_STATS
+/** @brief Number of times the waiters woke up and tested the flags */
+unsigned long event_wakeups [events_count], event_tests [events_count];
+
+const char * const event_names [events_count] = {
+    "none", "ultrasonic", "uart send", "uart receive", "motors left", "motors right",
+    "proximity"
+};
+#endif
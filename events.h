@@ -0,0 +1,113 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Event flags interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * --------------------------------------------------------
+ * An event flag is a byte set by whoever changes the state a task is
+ * waiting for (mostly interrupt handlers) and consumed by the one task
+ * that waits for it. SynthOS evaluates the condition of a waiting task
+ * on every scheduler round; with event_wait the condition is a single
+ * byte test and the real condition is only checked once per wake-up.
+ *
+ * The flag is cleared before the real condition is checked, so a change
+ * that happens in between is not lost.
+ *
+ * An event that more than one task may wait for at a time is
+ * signalled with event_signal_all and waited for with event_wait_all.
+ * Its flag counts the signals instead, and the waiters only compare it
+ * with what they saw before checking the condition, so none of them
+ * takes a wake-up from another. event_uart_send is such an event: print
+ * (with PRINT_LOSSY set to 0, from any task) and the command task write
+ * to the UART.
+ *
+ * With EVENT_STATS defined, the number of wake-ups and flag tests is
+ * counted per event.
+ */
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+
+/**
+ * @brief  Events
+ *
+ * event_none is a sink for the sources that do not signal anything.
+ */
+typedef enum {
+    event_none,
+    event_ultrasonic,    /* measurement complete or range gate */
+    event_uart_send,     /* room in the send buffer, any number of waiters */
+    event_uart_receive,  /* data in the receive buffer */
+    event_motors_left,   /* left motor timer or motors_action */
+    event_motors_right,  /* right motor timer or motors_action */
+    event_proximity,     /* new IR eye reflections, see eyes_modulate */
+    events_count
+} event_type;
+
+extern volatile uint8_t events [events_count];
+
+#ifdef EVENT_STATS
+extern unsigned long event_wakeups [events_count], event_tests [events_count];
+extern const char * const event_names [events_count];
+#define event_test(e) (event_tests [e] ++, events [e])
+#define event_woke(e) (event_wakeups [e] ++)
+#else
+#define event_test(e) (events [e])
+#define event_woke(e) ((void) 0)
+#endif
+
+/** @brief  Signals event \a e */
+#define event_signal(e) (events [e] = 1)
+
+/**
+ * @brief  Waits for condition \a cond, checking it only when event \a e is signalled
+ */
+#define event_wait(e, cond)                                             \
+    do {                                                                \
+        for (;;) {                                                      \
+            events [e] = 0;                                             \
+            if (cond)                                                   \
+                break;                                                  \
+            SynthOS_wait (event_test (e));                              \
+            event_woke (e);                                             \
+        }                                                               \
+    } while (0)
+
+/** @brief  Signals event \a e to all its waiters (see event_wait_all) */
+#define event_signal_all(e) (events [e] ++)
+
+/**
+ * @brief  Waits for condition \a cond, checking it only when event \a e is signalled with event_signal_all
+ *
+ * The flag is left as it is for the other waiters.
+ */
+#define event_wait_all(e, cond)                                         \
+    do {                                                                \
+        uint8_t _e;                                                     \
+        for (;;) {                                                      \
+            _e = events [e];                                            \
+            if (cond)                                                   \
+                break;                                                  \
+            SynthOS_wait (event_test (e) != _e);                        \
+            event_woke (e);                                             \
+        }                                                               \
+    } while (0)
+
+#endif
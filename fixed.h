@@ -0,0 +1,77 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Fixed point (Q format) helpers
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * --------------------------------------------------------
+ * The firmware does not use floating point: on the ATmega328p every
+ * float operation is a library call of a few hundred cycles, and the
+ * 32 bit divisions by constants are not much better (~600 cycles).
+ * Ratios are kept as Qn constants instead (the ratio times 2^n,
+ * rounded), which turns a conversion into a multiplication and a
+ * shift.
+ *
+ * fixed_q makes the constants out of integer ratios at compile time,
+ * so no float constant ever gets to the code. The values are listed
+ * by calculate.bc.
+ */
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/**
+ * @brief  Ratio num / den in Q"bits", rounded (a constant expression)
+ *
+ * num * 2^bits has to fit 32 bits.
+ */
+#define fixed_q(num, den, bits) \
+    ((((uint32_t) (num) << (bits)) + (den) / 2) / (den))
+
+/* Sound travels 343 m/s: 0.5us * 34300 cm/s / 2 = 343 / 40000 cm per
+   Timer 1 step */
+#define fixed_cm_per_step_q16 fixed_q (343, 40000, 16)
+#define fixed_steps_per_cm_q8 fixed_q (40000, 343, 8)
+
+/* Microseconds to milliseconds */
+#define fixed_ms_per_us_q20   fixed_q (1, 1000, 20)
+
+/**
+ * @brief  Multiplies by a Q"bits" constant, rounding the result
+ * @param  x  value
+ * @param  q  constant (see fixed_q)
+ * @param  bits  number of fraction bits of q, 1-31
+ * @return  x * q / 2^bits
+ *
+ * x * q + 2^(bits - 1) has to fit 32 bits.
+ */
+static inline uint32_t fixed_scale (uint32_t x, uint32_t q, uint8_t bits) {
+    return (x * q + (1UL << (bits - 1))) >> bits;
+}
+
+/**
+ * @brief  Converts microseconds to milliseconds
+ * @param  us  time up to 4000000 (4 s)
+ * @return  time in ms, rounded
+ */
+static inline uint32_t fixed_us_to_ms (uint32_t us) {
+    return fixed_scale (us, fixed_ms_per_us_q20, 20);
+}
+
+#endif
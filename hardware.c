@@ -25,18 +25,51 @@
  * IR eye            | digital pin 12, analog inputs 2-5
  * Ultrasonic sensor | digital pin 4
  * Buzzar            | digital pin 11
- * Pan servo         | digital pin 10
- * Tilt servo        | digital pin 9
+ * Pan servo         | digital pin 10 (OC1B)
+ * Tilt servo        | digital pin 9 (OC1A)
  *
  * Left and right motors and encoders are swaped to prevent
  * the wires from hanging.
+ *
+ * The ADC scans all the analog inputs we use once per clock
+ * tick. The scan is started by the timer module (Timer 2) just early
+ * enough to finish before the tick, and every conversion starts the
+ * next one from the ADC interrupt. Readers get the latest complete
+ * scan and never wait for a conversion.
+ *
+ * Between the scans the ADC converts the two encoder inputs in turn.
+ * The interrupt handler applies the hysteresis, timestamps the edges
+ * and hands the sector periods to the motor tasks through a ring
+ * buffer per encoder.
+ *
+ * With eyes_modulate on, the end of every scan switches the IR leds
+ * over, so the scans alternate between ambient light and ambient light
+ * plus the reflection. Every lit scan leaves the difference (the
+ * reflection alone) for the readers, 50 times a second.
+ *
+ * Servo pulses are made by the Timer 1 compare outputs: the pin is
+ * set on one compare match and cleared on the next one, so the pulse
+ * width does not depend on interrupt latency and interrupts stay
+ * enabled.
+ *
+ * Once given a position with pan_set or tilt_set, a servo is refreshed
+ * from the clock tick: it gets a pulse at the tick closest to a servo
+ * frame (20 ms) after the previous one, so it holds the position
+ * while the tasks do something else. A new position goes out right
+ * away unless the previous pulse was less than half a frame ago.
+ *
+ * The time a move takes comes from a model of the servo: the distance
+ * from the last position it was given (in us of pulse width) times
+ * its slew time plus a settle margin, see pan_set_model.
  */
 
 #include <avr/io.h>
 #include "aug-interrupt.h"
 #include "aug-delay.h"
-#include "aug-math.h"
+#include "aug-sleep.h"
 
+#include "events.h"
+#include "fixed.h"
 #include "timer.h"
 #include "hardware.h"
 
@@ -54,7 +87,126 @@ typedef enum {
  */
 volatile us_state_type us_state;
 
-static volatile unsigned us_begin_time, us_end_time;
+/* Echo edges in Timer 1 steps (0.5us) and the time of the last echo (see timer_us) */
+static volatile uint16_t us_begin_time, us_end_time;
+static volatile uint32_t us_end_stamp;
+
+/* The result of the last ping is in, it was cut by the range gate
+   (us_clear) and the gate has fired with the echo still up (us_gated) */
+static volatile uint8_t us_done, us_clear, us_gated;
+
+/* A ping was requested while the sensor was busy with a gated one */
+static volatile uint8_t us_pending;
+
+/* Range gate in Timer 1 steps, 0 if none */
+static uint16_t us_range;
+
+/* Wakes the waiter when the range gate is due */
+static timer_type us_gate;
+
+/** @brief Number of measurements made */
+unsigned long ultrasonic_count;
+
+/** @brief Number of measurements ended by the range gate */
+unsigned long ultrasonic_gate_count;
+
+/** @brief Time the range gate saved, in microseconds */
+unsigned long ultrasonic_gate_saved;
+
+/**
+ * @brief Servo pulse state machine states
+ */
+typedef enum {
+    servo_idle,
+    servo_rise,  /* waiting for the pin to go up */
+    servo_fall   /* waiting for the pin to go down */
+} servo_state_type;
+
+static volatile servo_state_type pan_state, tilt_state;
+static volatile unsigned pan_width, tilt_width;
+
+/* Timer 1 steps (0.5us) between a pulse request and the pulse */
+#define servo_lead 40
+
+/* Pulse width range a servo the position of which is not known may
+   have to cover, in us */
+#define servo_span 1200
+
+/**
+ * @brief Servo refresh state
+ *
+ * The move starts with the first pulse that carries the new position.
+ */
+typedef struct {
+    unsigned position;  /* pulse width in us, 0 - not refreshed */
+    unsigned slew;      /* us it takes to move by 1 us of pulse width */
+    unsigned settle;    /* us added to every move */
+    uint32_t travel;    /* time the move takes, in us */
+    uint32_t last;      /* time of the last pulse, see timer_us */
+    uint32_t arrival;   /* end of the move */
+    uint32_t started;   /* first pulse with the position, see timer_us */
+    uint8_t pending;    /* the position has not been sent yet */
+} servo_refresh_type;
+
+static volatile servo_refresh_type pan_refresh, tilt_refresh;
+
+static const uint8_t adc_channels [] = { ADC_CHANNELS };
+
+#define adc_count (sizeof (adc_channels) / sizeof (adc_channels [0]))
+
+/* Timer 2 steps (64us) a scan takes: 13 ADC cycles (104us) per input */
+#define adc_lead ((adc_count * 13 * 128) / 1024 + 2)
+
+/**
+ * @brief ADC samples
+ *
+ * Scans alternate between the two banks. The bank with the latest
+ * complete scan is selected by the lowest bit of adc_sequence_number.
+ */
+static volatile uint16_t adc_samples [2] [adc_count];
+static volatile uint8_t adc_sequence_number, adc_slot;
+
+/* A scan is due as soon as the conversion in progress is over */
+static volatile uint8_t adc_scan_pending;
+
+/* IR eye front-end: modulation is on, the last readings with the leds
+   off, the last reflections and their counter */
+static volatile uint8_t eye_modulation;
+static uint16_t eye_dark [eyes_count];
+static volatile int16_t eye_lit [eyes_count];
+static volatile uint8_t eye_sequence_number;
+
+/* Encoder hysteresis: readings this far from the middle change the level */
+#define encoder_middle 840
+#define encoder_margin  10
+
+/* Edges closer than that (us) are the wheel rocking on a sector
+   boundary as it stops or reverses, not a sector */
+#define encoder_min_period 50000UL
+
+/* Encoder ring buffer size, a power of 2 */
+#define encoder_ring 8
+
+/**
+ * @brief Encoder front-end state
+ *
+ * The ADC interrupt handler puts the periods in, the motor task
+ * takes them out.
+ */
+typedef struct {
+    int8_t level;      /* -1 - low, 1 - high, 0 - not known yet */
+    uint8_t started;   /* edge_time is valid */
+    uint8_t event;     /* signalled on every edge */
+    uint32_t edge_time;
+    volatile uint8_t put, get;
+    uint32_t periods [encoder_ring];
+    int8_t levels [encoder_ring];
+} encoder_state_type;
+
+static encoder_state_type encoders [2];
+
+/** @brief Number of encoder edges lost because the ring buffer was full */
+unsigned long encoder_overruns;
 
 /**
  * @brief Hardware initialization routine
@@ -62,6 +214,10 @@ static volatile unsigned us_begin_time, us_end_time;
 static void hardware_init (void) __attribute__ ((constructor));
 static void hardware_init (void) {
     /* Ultrasonic distance sensor interrupt setup */
+    us_state = us_end;
+    us_done = 1;
+    us_gate.event = event_ultrasonic;
+    ultrasonic_set_range (ULTRASONIC_RANGE);
     PCMSK2 &= ~_BV (PCINT20);
     PCICR |= _BV (PCIE2);
 
@@ -75,7 +231,15 @@ static void hardware_init (void) {
     DDRB |= _BV (DDB0);
 
     /* Multiplexer setup */
-    ADCSRA = _BV (ADPS0) | _BV (ADPS1) | _BV (ADPS2) | _BV (ADEN);
+    ADCSRA = _BV (ADPS0) | _BV (ADPS1) | _BV (ADPS2) | _BV (ADEN) | _BV (ADIE);
+    adc_slot = adc_count;
+
+    /* Encoder edges wake the motor tasks up */
+    encoders [encoder_left].event = event_motors_left;
+    encoders [encoder_right].event = event_motors_right;
+
+    /* ADC scan start, adc_lead steps before the clock tick */
+    timer_set_phase (clock_divider - adc_lead);
 
     /* IR leds pin is set to output */
     DDRB |= _BV (DDB4);
@@ -91,49 +255,371 @@ static void hardware_init (void) {
 
     /* Tilt pin is set to output */
     DDRB |= _BV (DDB1);
+
+    /* Servo models */
+    pan_refresh.slew = PAN_SLEW;
+    pan_refresh.settle = PAN_SETTLE;
+    tilt_refresh.slew = TILT_SLEW;
+    tilt_refresh.settle = TILT_SETTLE;
+
+    /* Servo timer, normal mode
+       16000000 / 8 = 2000000 (0.5us steps) */
+    TCCR1A = 0;
+    TCCR1B = _BV (CS11);
 }
 
-static void send_to_servo (volatile uint8_t * port, uint8_t bits, unsigned duration) {
-    unsigned i;
+/**
+ * @brief  Starts a servo pulse
+ * @param  ocr  compare register of the channel
+ * @param  com  "set on compare match" bits of the channel
+ * @param  interrupt  compare interrupt enable bit of the channel
+ * @param  state  channel state
+ * @param  width  channel pulse width
+ * @param  duration  pulse duration in microseconds
+ */
+static void send_to_servo (volatile uint16_t * ocr, uint8_t com, uint8_t interrupt,
+                           volatile servo_state_type * state, volatile unsigned * width,
+                           unsigned duration) {
+    uint8_t sreg = SREG;
 
-    /* We disable interrupts to guarantee precision of the delay */
     cli ();
-    *port |= bits;
-    for (i = 0; i < duration; i += 10)
-        _delay_us (10);
-    *port &= ~bits;
-    sei ();
+
+    /* A pulse that is still going on wins */
+    if (*state == servo_idle) {
+        *width = duration * 2;
+        *state = servo_rise;
+        TCCR1A |= com;
+        *ocr = TCNT1 + servo_lead;
+        TIMSK1 |= interrupt;
+    }
+
+    SREG = sreg;
+}
+
+/**
+ * @brief  Advances a servo pulse on a compare match
+ *
+ * There may be a stale compare flag when the interrupt gets enabled,
+ * so we look at the pin to see what has actually happened.
+ * @param  ocr  compare register of the channel
+ * @param  com  "set on compare match" bits of the channel
+ * @param  interrupt  compare interrupt enable bit of the channel
+ * @param  state  channel state
+ * @param  width  channel pulse width
+ * @param  pin  channel pin bit in PINB
+ */
+static void servo_compare (volatile uint16_t * ocr, uint8_t com, uint8_t interrupt,
+                           volatile servo_state_type * state, volatile unsigned * width,
+                           uint8_t pin) {
+    switch (*state) {
+      case servo_rise:
+        if ((PINB & pin) == 0)
+            break;
+        /* Clear on the next match: COMx1 stays, COMx0 goes */
+        TCCR1A &= ~(com & (com >> 1));
+        *ocr += *width;
+        *state = servo_fall;
+        break;
+      case servo_fall:
+        if ((PINB & pin) != 0)
+            break;
+        /* Give the pin back to the port */
+        TCCR1A &= ~com;
+        TIMSK1 &= ~interrupt;
+        *state = servo_idle;
+        break;
+      default:
+        break;
+    }
+}
+
+/* Tilt servo pulse edge */
+ISR (TIMER1_COMPA_vect) {
+    servo_compare (&OCR1A, _BV (COM1A1) | _BV (COM1A0), _BV (OCIE1A),
+                   &tilt_state, &tilt_width, _BV (PINB1));
+}
+
+/* Pan servo pulse edge */
+ISR (TIMER1_COMPB_vect) {
+    servo_compare (&OCR1B, _BV (COM1B1) | _BV (COM1B0), _BV (OCIE1B),
+                   &pan_state, &pan_width, _BV (PINB2));
+}
+
+/**
+ * @brief  Sends the refresh pulse if it is due
+ *
+ * Called with interrupts disabled.
+ * @param  ocr  compare register of the channel
+ * @param  com  "set on compare match" bits of the channel
+ * @param  interrupt  compare interrupt enable bit of the channel
+ * @param  state  channel state
+ * @param  width  channel pulse width
+ * @param  refresh  channel refresh state
+ * @param  gap  time in us that has to pass since the previous pulse
+ */
+static void servo_refresh (volatile uint16_t * ocr, uint8_t com, uint8_t interrupt,
+                           volatile servo_state_type * state, volatile unsigned * width,
+                           volatile servo_refresh_type * refresh, uint32_t gap) {
+    uint32_t now;
+
+    if (refresh->position == 0 || *state != servo_idle)
+        return;
+    now = timer_us ();
+    if (now - refresh->last < gap)
+        return;
+    send_to_servo (ocr, com, interrupt, state, width, refresh->position);
+    refresh->last = now;
+    if (refresh->pending) {
+        refresh->pending = 0;
+        refresh->started = now;
+        refresh->arrival = now + refresh->travel;
+    }
+}
+
+/**
+ * @brief  Refreshes the servos, called from the clock tick interrupt
+ */
+void servo_tick (void) {
+    servo_refresh (&OCR1B, _BV (COM1B1) | _BV (COM1B0), _BV (OCIE1B),
+                   &pan_state, &pan_width, &pan_refresh,
+                   pan_refresh.pending ? servo_frame / 2 : servo_frame - timer_tick_us / 2);
+    servo_refresh (&OCR1A, _BV (COM1A1) | _BV (COM1A0), _BV (OCIE1A),
+                   &tilt_state, &tilt_width, &tilt_refresh,
+                   tilt_refresh.pending ? servo_frame / 2 : servo_frame - timer_tick_us / 2);
+}
+
+/**
+ * @brief  Gives a servo a new position
+ * @param  refresh  channel refresh state
+ * @param  duration  pulse duration in microseconds
+ */
+static void servo_set (volatile servo_refresh_type * refresh, unsigned duration) {
+    unsigned distance;
+    uint8_t sreg = SREG;
+
+    if (refresh->position == 0)
+        distance = servo_span;
+    else if (duration > refresh->position)
+        distance = duration - refresh->position;
+    else
+        distance = refresh->position - duration;
+
+    cli ();
+    if (refresh->position == 0)
+        /* Nothing was sent for long */
+        refresh->last = timer_us () - servo_frame;
+    refresh->travel = (uint32_t) distance * refresh->slew + refresh->settle;
+    refresh->position = duration;
+    refresh->pending = 1;
+    SREG = sreg;
+}
+
+/**
+ * @brief  Sets the model of a servo
+ * @param  refresh  channel refresh state
+ * @param  slew  us it takes to move by 1 us of pulse width
+ * @param  settle  us added to every move
+ */
+static void servo_set_model (volatile servo_refresh_type * refresh, unsigned slew, unsigned settle) {
+    uint8_t sreg = SREG;
+
+    cli ();
+    refresh->slew = slew;
+    refresh->settle = settle;
+    SREG = sreg;
+}
+
+/**
+ * @brief  Tells whether a servo move is over
+ * @param  refresh  channel refresh state
+ */
+static uint8_t servo_reached (volatile servo_refresh_type * refresh) {
+    uint32_t arrival;
+    uint8_t sreg = SREG;
+
+    cli ();
+    arrival = refresh->arrival;
+    if (refresh->pending) {
+        SREG = sreg;
+        return 0;
+    }
+    SREG = sreg;
+    return timer_due (arrival);
+}
+
+/**
+ * @brief  Moves pan servo and keeps it there
+ *
+ * Returns right away, see pan_reached.
+ * @param  duration  pulse duration in microseconds
+ */
+void pan_set (unsigned duration) {
+    uint8_t sreg = SREG;
+
+    servo_set (&pan_refresh, duration);
+    cli ();
+    servo_refresh (&OCR1B, _BV (COM1B1) | _BV (COM1B0), _BV (OCIE1B),
+                   &pan_state, &pan_width, &pan_refresh, servo_frame / 2);
+    SREG = sreg;
+}
+
+/**
+ * @brief  Tells whether pan servo has got to the position
+ *         of the last pan_set
+ */
+uint8_t pan_reached (void) {
+    return servo_reached (&pan_refresh);
+}
+
+/**
+ * @brief  Tells when the move of the last pan_set started
+ * @param  time  gets the timer_us of its first pulse, if it has gone out
+ * @return  not 0 if it has
+ *
+ * The pulse starts within 20us of that time.
+ */
+uint8_t pan_started (uint32_t * time) {
+    uint8_t sreg = SREG;
+
+    cli ();
+    if (pan_refresh.pending) {
+        SREG = sreg;
+        return 0;
+    }
+    *time = pan_refresh.started;
+    SREG = sreg;
+    return 1;
+}
+
+/**
+ * @brief  Sets the model of pan servo
+ * @param  slew  us it takes to move by 1 us of pulse width
+ * @param  settle  us added to every move
+ */
+void pan_set_model (unsigned slew, unsigned settle) {
+    servo_set_model (&pan_refresh, slew, settle);
+}
+
+/**
+ * @brief  Tells how long a pan servo move takes
+ * @param  distance  move in us of pulse width
+ * @return  time in us
+ */
+uint32_t pan_travel (unsigned distance) {
+    return (uint32_t) distance * pan_refresh.slew + pan_refresh.settle;
+}
+
+/**
+ * @brief  Moves tilt servo and keeps it there
+ *
+ * Returns right away, see tilt_reached.
+ * @param  duration  pulse duration in microseconds
+ */
+void tilt_set (unsigned duration) {
+    uint8_t sreg = SREG;
+
+    servo_set (&tilt_refresh, duration);
+    cli ();
+    servo_refresh (&OCR1A, _BV (COM1A1) | _BV (COM1A0), _BV (OCIE1A),
+                   &tilt_state, &tilt_width, &tilt_refresh, servo_frame / 2);
+    SREG = sreg;
+}
+
+/**
+ * @brief  Tells whether tilt servo has got to the position
+ *         of the last tilt_set
+ */
+uint8_t tilt_reached (void) {
+    return servo_reached (&tilt_refresh);
+}
+
+/**
+ * @brief  Sets the model of tilt servo
+ * @param  slew  us it takes to move by 1 us of pulse width
+ * @param  settle  us added to every move
+ */
+void tilt_set_model (unsigned slew, unsigned settle) {
+    servo_set_model (&tilt_refresh, slew, settle);
 }
 
 /**
  * @brief  Sends a pulse to pan servo
+ *
+ * Returns right away, the pulse starts within 20us. A request made
+ * while the previous pulse is still going on is ignored.
  * @param  duration  pulse duratio in microseconds
  */
 void pan_pulse (unsigned duration) {
-    send_to_servo (&PORTB, _BV (PORTB2), duration);
+    send_to_servo (&OCR1B, _BV (COM1B1) | _BV (COM1B0), _BV (OCIE1B),
+                   &pan_state, &pan_width, duration);
 }
 
 /**
  * @brief  Sends a pulse to tilt servo
+ *
+ * Returns right away, the pulse starts within 20us. A request made
+ * while the previous pulse is still going on is ignored.
  * @param  duration  pulse duratio in microseconds
  */
 void tilt_pulse (unsigned duration) {
-    send_to_servo (&PORTB, _BV (PORTB1), duration);
+    send_to_servo (&OCR1A, _BV (COM1A1) | _BV (COM1A0), _BV (OCIE1A),
+                   &tilt_state, &tilt_width, duration);
+}
+
+/* Sends a ping, called with interrupts disabled */
+static void ultrasonic_trigger (void) {
+    us_state = us_none;
+
+    PCIFR &= ~_BV (PCIF2);
+
+    PORTD &= ~_BV (PORTD4);
+    DDRD |= _BV (DDD4);
+    _delay_us (2);
+    PORTD |= _BV (PORTD4);
+    _delay_us (15);
+    PORTD &= ~_BV (PORTD4);
+    _delay_us (2);
+    DDRD &= ~_BV (DDD4);
+
+    PCMSK2 |= _BV (PCINT20);
 }
 
 /* Ultraonic sensor interrupt handler */
 ISR (PCINT2_vect) {
+    /* Take the time first to keep the latency out */
+    uint16_t now = TCNT1;
+
     switch (us_state) {
       case us_none:
         /* Sensor whistles */
-        us_begin_time = pclock ();
+        us_begin_time = now;
         us_state = us_begin;
+        if (us_range != 0)
+            /* One more step for the 64us resolution of timer_us */
+            timer_start (&us_gate, timer_us () + us_range / 2 + 64);
         break;
       case us_begin:
         /* Sensor got an echo or a timeout */
-        us_end_time = pclock ();
         us_state = us_end;
         PCMSK2 &= ~_BV (PCINT20);
+        if (us_gated) {
+            /* The result went out when the gate fired */
+            us_gated = 0;
+            ultrasonic_gate_saved += (uint16_t) (now - us_end_time) / 2;
+            if (us_pending) {
+                /* The held ping gets its own start and gate (see us_none) */
+                us_pending = 0;
+                us_begin_time = now;
+                ultrasonic_trigger ();
+            }
+        } else {
+            us_end_time = now;
+            us_end_stamp = timer_us ();
+            us_clear = 0;
+            us_done = 1;
+            ultrasonic_count ++;
+            event_signal (event_ultrasonic);
+        }
         break;
       default:
         break;
@@ -141,35 +627,115 @@ ISR (PCINT2_vect) {
 }
 
 /**
- * @brief   Measure distance before to an object using ultrasonic sensor
- * @return  distance in cm
+ * @brief   Sets the range gate
+ * @param   range  maximum distance of interest in cm, 0 to wait for the sensor
+ *
+ * Once the echo has been up for longer than the range takes, the
+ * measurement ends with ultrasonic_clear. The sensor itself stays
+ * busy until its own echo or timeout.
  */
-unsigned ultrasonic_measure () {
+void ultrasonic_set_range (unsigned range) {
+    /* Past 561 cm the steps do not fit 16 bits anyway */
+    unsigned long steps = range > 561 ? 0xFFFF : fixed_scale (range, fixed_steps_per_cm_q8, 8);
+
+    us_range = steps > 0xFFFF ? 0xFFFF : steps;
+}
+
+/**
+ * @brief   Starts a distance measurement (sends a ping)
+ *
+ * Returns right away. If a measurement is already in flight,
+ * it is left alone and its result is what we are going to get.
+ * If the sensor is still busy with a gated one, the ping is sent
+ * as soon as the sensor is done.
+ */
+void ultrasonic_start (void) {
     uint8_t sreg = SREG;
 
+    if (! us_done)
+        return;
+
     cli ();
+    us_done = 0;
+    if (us_state != us_end)
+        us_pending = 1;
+    else
+        ultrasonic_trigger ();
+    SREG = sreg;
+}
 
-    us_state = us_none;
+/**
+ * @brief   Tells whether the last measurement is complete
+ * @return  not 0 if there is no measurement in flight
+ *
+ * This is also where the range gate fires.
+ */
+uint8_t ultrasonic_ready (void) {
+    uint8_t sreg;
+    uint16_t now;
 
-    PCIFR &= ~_BV (PCIF2);
+    /* A held ping has not been sent yet: the echo that is up is the
+       gated one, not ours */
+    if (us_done || us_pending || us_range == 0 || us_state != us_begin)
+        return us_done;
 
-    PORTD &= ~_BV (PORTD4);
-    DDRD |= _BV (DDD4);
-    _delay_us (2);
-    PORTD |= _BV (PORTD4);
-    _delay_us (15);
-    PORTD &= ~_BV (PORTD4);
-    _delay_us (2);
-    DDRD &= ~_BV (DDD4);
+    sreg = SREG;
+    cli ();
+    now = TCNT1;
+    if (! us_done && ! us_pending && us_state == us_begin && (uint16_t) (now - us_begin_time) >= us_range) {
+        us_end_time = now;
+        us_end_stamp = timer_us ();
+        us_clear = 1;
+        us_gated = 1;
+        us_done = 1;
+        ultrasonic_count ++;
+        ultrasonic_gate_count ++;
+    }
+    SREG = sreg;
+    return us_done;
+}
 
-    PCMSK2 |= _BV (PCINT20);
+/**
+ * @brief   Reports the result of the last complete measurement
+ * @param   age  if not 0, gets the number of microseconds since the echo
+ * @return  distance in cm or ultrasonic_clear
+ */
+unsigned ultrasonic_last (uint32_t * age) {
+    uint8_t sreg = SREG, clear;
+    uint16_t echo;
+    uint32_t end_stamp;
 
+    cli ();
+    echo = us_end_time - us_begin_time;
+    end_stamp = us_end_stamp;
+    clear = us_clear;
     SREG = sreg;
 
-    SynthOS_wait (us_state == us_end);
+    if (age != 0)
+        *age = timer_us () - end_stamp;
+    if (clear)
+        return ultrasonic_clear;
 
-    /* Sound travels 343 m/s */
-    return round (time_step * pdiff (us_begin_time, us_end_time) * 343 * 100 / 2);
+    return fixed_scale (echo, fixed_cm_per_step_q16, 16);
+}
+
+/**
+ * @brief   Waits for the measurement in flight
+ * @return  distance in cm
+ */
+unsigned ultrasonic_wait () {
+    event_wait (event_ultrasonic, ultrasonic_ready ());
+    return ultrasonic_last (0);
+}
+
+/**
+ * @brief   Measure distance before to an object using ultrasonic sensor
+ * @return  distance in cm
+ */
+unsigned ultrasonic_measure () {
+    ultrasonic_start ();
+    event_wait (event_ultrasonic, ultrasonic_ready ());
+    return ultrasonic_last (0);
 }
 
 /** @brief  Enables (starts) left motor */
@@ -229,16 +795,214 @@ void right_motor_backward (void) {
 }
 
 /**
- * @brief Reads ADC converted value from a given
+ * @brief  Starts an ADC scan
+ *
+ * Called from the Timer 2 interrupts adc_lead steps before the clock tick.
+ */
+void adc_scan (void) {
+    if (adc_slot < adc_count)
+        /* Should the previous scan be still running, let it finish */
+        return;
+    if (ADCSRA & (_BV (ADSC) | _BV (ADIF))) {
+        /* An encoder conversion, start when it is over. Should it be
+           over but not handled yet, ADMUX still has to tell the handler
+           which encoder it was. */
+        adc_scan_pending = 1;
+        return;
+    }
+    adc_slot = 0;
+    ADMUX = _BV (REFS0) | adc_channels [0];
+    ADCSRA |= _BV (ADSC);
+}
+
+/**
+ * @brief  Looks for an edge in an encoder reading
+ * @param  e  encoder
+ * @param  v  ADC reading
+ *
+ * Publishes the time since the previous edge, 0 for the first
+ * edge after encoder_flush or after a glitch.
+ */
+static void encoder_sample (encoder_state_type * e, uint16_t v) {
+    int8_t level;
+    uint32_t now;
+    uint8_t put;
+
+    if (v <= encoder_middle - encoder_margin)
+        level = -1;
+    else if (v >= encoder_middle + encoder_margin)
+        level = 1;
+    else
+        return;
+    if (level == e->level)
+        return;
+    if (e->level == 0) {
+        /* The first reading, not an edge */
+        e->level = level;
+        return;
+    }
+    e->level = level;
+
+    now = timer_us ();
+    if (e->started && now - e->edge_time < encoder_min_period) {
+        /* A glitch, start over from here */
+        e->edge_time = now;
+        e->started = 0;
+        return;
+    }
+    put = e->put;
+    if (((put + 1) & (encoder_ring - 1)) == e->get)
+        encoder_overruns ++;
+    else {
+        e->periods [put] = e->started ? now - e->edge_time : 0;
+        e->levels [put] = level;
+        e->put = (put + 1) & (encoder_ring - 1);
+    }
+    e->edge_time = now;
+    e->started = 1;
+    event_signal (e->event);
+}
+
+/**
+ * @brief  Takes the eye readings of a complete scan and switches the leds over
+ * @param  samples  the scan
+ */
+static void eye_scan (volatile uint16_t * samples) {
+    uint8_t i, j;
+
+    for (i = 0; i < eyes_count; i ++) {
+        for (j = 0; j < adc_count; j ++)
+            if (adc_channels [j] == i + 2)
+                break;
+        if (j == adc_count)
+            continue;
+        if (PORTB & _BV (PORTB4))
+            eye_lit [i] = (int16_t) (samples [j] - eye_dark [i]);
+        else
+            eye_dark [i] = samples [j];
+    }
+    if (PORTB & _BV (PORTB4)) {
+        PORTB &= ~_BV (PORTB4);
+        eye_sequence_number ++;
+        event_signal (event_proximity);
+    } else
+        PORTB |= _BV (PORTB4);
+}
+
+/*
+ * ADC conversion complete
+ *
+ * Between the scans the ADC keeps converting the encoder inputs in
+ * turn (104us each), so an encoder edge is seen within ~0.2ms.
+ */
+ISR (ADC_vect) {
+    uint16_t v;
+    uint8_t input;
+
+    v = ADCL;
+    v |= (uint16_t) ADCH << 8;
+    input = ADMUX & 0x0F;
+    if (input <= encoder_right)
+        encoder_sample (&encoders [input], v);
+
+    if (adc_slot < adc_count) {
+        adc_samples [(adc_sequence_number + 1) & 1] [adc_slot] = v;
+        if (++ adc_slot < adc_count) {
+            ADMUX = _BV (REFS0) | adc_channels [adc_slot];
+            ADCSRA |= _BV (ADSC);
+            return;
+        }
+        /* The scan is complete, swap the banks */
+        if (eye_modulation)
+            eye_scan (adc_samples [(adc_sequence_number + 1) & 1]);
+        adc_sequence_number ++;
+    } else if (adc_scan_pending) {
+        adc_scan_pending = 0;
+        adc_slot = 0;
+        ADMUX = _BV (REFS0) | adc_channels [0];
+        ADCSRA |= _BV (ADSC);
+        return;
+    }
+
+    ADMUX = _BV (REFS0) | (input == encoder_left ? encoder_right : encoder_left);
+    ADCSRA |= _BV (ADSC);
+}
+
+/**
+ * @brief  Drops the encoder periods not taken yet
+ * @param  encoder  encoder_left or encoder_right
+ *
+ * The next edge starts a new sequence of periods.
+ */
+void encoder_flush (uint8_t encoder) {
+    encoder_state_type * e = & encoders [encoder];
+    uint8_t sreg = SREG;
+
+    cli ();
+    e->get = e->put;
+    e->started = 0;
+    SREG = sreg;
+}
+
+/**
+ * @brief  Tells whether there is an encoder period to take
+ * @param  encoder  encoder_left or encoder_right
+ * @return  not 0 if there is
+ */
+uint8_t encoder_ready (uint8_t encoder) {
+    return encoders [encoder].get != encoders [encoder].put;
+}
+
+/**
+ * @brief  Takes the oldest encoder period
+ * @param  encoder  encoder_left or encoder_right
+ * @param  level  gets the level (-1/1) the edge ended the period with
+ * @return  period in microseconds, 0 for the first edge
+ *
+ * Call only if encoder_ready says there is one.
+ */
+uint32_t encoder_period (uint8_t encoder, int8_t * level) {
+    encoder_state_type * e = & encoders [encoder];
+    uint8_t get = e->get;
+    uint32_t period = e->periods [get];
+
+    * level = e->levels [get];
+    e->get = (get + 1) & (encoder_ring - 1);
+    return period;
+}
+
+/**
+ * @brief  Reports the number of complete ADC scans
+ *
+ * A reader can compare the values it gets to tell whether new
+ * samples have arrived.
+ * @return  scan counter (wraps around)
+ */
+uint8_t adc_sequence (void) {
+    return adc_sequence_number;
+}
+
+/**
+ * @brief Reads the latest ADC converted value from a given
  *        analog input
  * @param  pin  input pin (0-15)
  * @return  10 bit value from ADC
 */
 static uint16_t read_mux (uint8_t pin) {
-    ADMUX = _BV (REFS0) | pin;
-    ADCSRA |= _BV (ADSC);
-    while (ADCSRA & _BV (ADSC)) {} // 13 ADC cycles
-    return (uint16_t) ADCL | (uint16_t) ADCH << 8;
+    uint8_t i, sequence;
+    uint16_t v;
+
+    for (i = 0; i < adc_count; i ++)
+        if (adc_channels [i] == pin)
+            break;
+    if (i == adc_count)
+        return 0;
+    /* Retry if the banks were swapped while we were reading */
+    do {
+        sequence = adc_sequence_number;
+        v = adc_samples [sequence & 1] [i];
+    } while (sequence != adc_sequence_number);
+    return v;
 }
 
 
@@ -298,6 +1062,48 @@ uint16_t bottom_eye (void) {
     return read_mux (5);
 }
 
+/**
+ * @brief  Starts or stops the IR eye modulation
+ * @param  on  not 0 to start
+ *
+ * The leds belong to the modulation while it is on; stopping it
+ * switches them off.
+ */
+void eyes_modulate (uint8_t on) {
+    uint8_t sreg = SREG;
+
+    cli ();
+    eye_modulation = on;
+    if (! on)
+        PORTB &= ~_BV (PORTB4);
+    SREG = sreg;
+}
+
+/**
+ * @brief  Reports the number of reflections made
+ *
+ * Readers compare the values to tell whether there are new ones.
+ * @return  counter (wraps around)
+ */
+uint8_t eyes_sequence (void) {
+    return eye_sequence_number;
+}
+
+/**
+ * @brief  Reads the last reflection an eye got
+ * @param  eye  eye_xxx
+ * @return  lit less ambient reading, 0 if the eye is not scanned
+ */
+int16_t eye_reflection (uint8_t eye) {
+    int16_t v;
+    uint8_t sreg = SREG;
+
+    cli ();
+    v = eye_lit [eye];
+    SREG = sreg;
+    return v;
+}
+
 /** @brief Enables infrared leds  */
 void ir_leds_enable (void) {
     PORTB |= _BV (PORTB4);
@@ -331,5 +1137,5 @@ void buzzer_disable (void) {
 /** @brief Shuts system power down  */
 void power_down (void) {
     SMCR = _BV (SM1) | _BV (SE);
-    __asm__ __volatile__ ("sleep" ::: "memory");
+    sleep_cpu ();
 }
@@ -21,8 +21,61 @@
 
 #include <stdint.h>
 
+/**
+ * @brief  Analog inputs scanned by the ADC, in scan order
+ *
+ * Inputs that are not on the list read as 0.
+ */
+#ifndef ADC_CHANNELS
+#define ADC_CHANNELS 0, 1, 2, 3, 4, 5, 8
+#endif
+
+/**
+ * @brief  Initial ultrasonic range gate in cm, 0 for none
+ */
+#ifndef ULTRASONIC_RANGE
+#define ULTRASONIC_RANGE 0
+#endif
+
+/** @brief  Time a servo works on a pulse, in microseconds */
+#define servo_frame 20000UL
+
+/**
+ * @brief  Servo models: us a servo takes to move by 1 us of pulse
+ *         width and us it needs to settle after a move
+ *
+ * The defaults are on the slow side: 0.4 s for 1000 us (~150
+ * degrees). pan_set_model and tilt_set_model change them at run time.
+ */
+#ifndef PAN_SLEW
+#define PAN_SLEW 400
+#endif
+#ifndef PAN_SETTLE
+#define PAN_SETTLE 4000
+#endif
+#ifndef TILT_SLEW
+#define TILT_SLEW 400
+#endif
+#ifndef TILT_SETTLE
+#define TILT_SETTLE 4000
+#endif
+
+/** @brief  Distance reported when nothing was found within the range gate */
+#define ultrasonic_clear 0xFFFF
+
+extern unsigned long ultrasonic_gate_count, ultrasonic_gate_saved;
+
 void pan_pulse (unsigned duration);
 void tilt_pulse (unsigned duration);
+void pan_set (unsigned duration);
+uint8_t pan_reached (void);
+uint8_t pan_started (uint32_t * time);
+void pan_set_model (unsigned slew, unsigned settle);
+uint32_t pan_travel (unsigned distance);
+void tilt_set (unsigned duration);
+uint8_t tilt_reached (void);
+void tilt_set_model (unsigned slew, unsigned settle);
+void servo_tick (void);
 void left_motor_enable (void);
 void left_motor_disable (void);
 void left_motor_forward (void);
@@ -33,6 +86,17 @@ void right_motor_forward (void);
 void right_motor_backward (void);
 void left_motor_set (uint8_t torque);
 void right_motor_set (uint8_t torque);
+/** @brief  Wheel encoders, also their analog inputs */
+typedef enum {
+    encoder_left,
+    encoder_right
+} encoder_type;
+
+extern unsigned long encoder_overruns;
+
+void encoder_flush (uint8_t encoder);
+uint8_t encoder_ready (uint8_t encoder);
+uint32_t encoder_period (uint8_t encoder, int8_t * level);
 uint16_t left_encoder (void);
 uint16_t right_encoder (void);
 uint16_t temperature (void);
@@ -40,6 +104,24 @@ uint16_t left_eye (void);
 uint16_t top_eye (void);
 uint16_t right_eye (void);
 uint16_t bottom_eye (void);
+/** @brief  IR eyes, their analog inputs are 2 higher */
+typedef enum {
+    eye_left,
+    eye_top,
+    eye_right,
+    eye_bottom,
+    eyes_count
+} eye_type;
+
+void eyes_modulate (uint8_t on);
+uint8_t eyes_sequence (void);
+int16_t eye_reflection (uint8_t eye);
+uint8_t adc_sequence (void);
+void adc_scan (void);
+void ultrasonic_set_range (unsigned range);
+void ultrasonic_start (void);
+uint8_t ultrasonic_ready (void);
+unsigned ultrasonic_last (uint32_t * age);
 
 void ir_leds_enable (void);
 void ir_leds_disable (void);
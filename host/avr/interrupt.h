@@ -0,0 +1,38 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Interrupt control for the host build
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Interrupt handlers become ordinary functions named after their
+ * vectors. The simulator calls them (see host.c) when the
+ * corresponding flag is raised, the source is enabled and the I bit
+ * of SREG is set.
+ */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include "avr/io.h"
+
+#define ISR(vector) void vector (void)
+
+void sei (void);
+void cli (void);
+
+#endif
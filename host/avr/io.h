@@ -0,0 +1,240 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Simulated Atmega328p register file for the host build
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Every register access goes through host_reg/host_reg16, which
+ * advances the simulated time and lets the peripherals react to what
+ * the firmware wrote since the previous access. Addresses are the
+ * real data space addresses, so 16 bit registers overlay their
+ * low/high byte pairs the same way they do on the chip.
+ *
+ * Flag registers are plain memory here: writing 0 clears a flag
+ * and writing 1 sets it (the chip does the opposite).
+ */
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+volatile uint8_t * host_reg (unsigned addr);
+volatile uint16_t * host_reg16 (unsigned addr);
+
+#define _SFR_MEM8(a)  (*host_reg (a))
+#define _SFR_MEM16(a) (*host_reg16 (a))
+#define _BV(bit)      (1 << (bit))
+
+#define PINB    _SFR_MEM8 (0x23)
+#define DDRB    _SFR_MEM8 (0x24)
+#define PORTB   _SFR_MEM8 (0x25)
+#define PINC    _SFR_MEM8 (0x26)
+#define DDRC    _SFR_MEM8 (0x27)
+#define PORTC   _SFR_MEM8 (0x28)
+#define PIND    _SFR_MEM8 (0x29)
+#define DDRD    _SFR_MEM8 (0x2A)
+#define PORTD   _SFR_MEM8 (0x2B)
+#define TIFR0   _SFR_MEM8 (0x35)
+#define TIFR1   _SFR_MEM8 (0x36)
+#define TIFR2   _SFR_MEM8 (0x37)
+#define PCIFR   _SFR_MEM8 (0x3B)
+#define GPIOR0  _SFR_MEM8 (0x3E)
+#define GTCCR   _SFR_MEM8 (0x43)
+#define TCCR0A  _SFR_MEM8 (0x44)
+#define TCCR0B  _SFR_MEM8 (0x45)
+#define TCNT0   _SFR_MEM8 (0x46)
+#define OCR0A   _SFR_MEM8 (0x47)
+#define OCR0B   _SFR_MEM8 (0x48)
+#define GPIOR1  _SFR_MEM8 (0x4A)
+#define GPIOR2  _SFR_MEM8 (0x4B)
+#define ACSR    _SFR_MEM8 (0x50)
+#define SMCR    _SFR_MEM8 (0x53)
+#define SREG    _SFR_MEM8 (0x5F)
+#define PCICR   _SFR_MEM8 (0x68)
+#define PCMSK0  _SFR_MEM8 (0x6B)
+#define PCMSK1  _SFR_MEM8 (0x6C)
+#define PCMSK2  _SFR_MEM8 (0x6D)
+#define TIMSK0  _SFR_MEM8 (0x6E)
+#define TIMSK1  _SFR_MEM8 (0x6F)
+#define TIMSK2  _SFR_MEM8 (0x70)
+#define ADC     _SFR_MEM16 (0x78)
+#define ADCW    _SFR_MEM16 (0x78)
+#define ADCL    _SFR_MEM8 (0x78)
+#define ADCH    _SFR_MEM8 (0x79)
+#define ADCSRA  _SFR_MEM8 (0x7A)
+#define ADCSRB  _SFR_MEM8 (0x7B)
+#define ADMUX   _SFR_MEM8 (0x7C)
+#define DIDR0   _SFR_MEM8 (0x7E)
+#define TCCR1A  _SFR_MEM8 (0x80)
+#define TCCR1B  _SFR_MEM8 (0x81)
+#define TCCR1C  _SFR_MEM8 (0x82)
+#define TCNT1   _SFR_MEM16 (0x84)
+#define ICR1    _SFR_MEM16 (0x86)
+#define OCR1A   _SFR_MEM16 (0x88)
+#define OCR1B   _SFR_MEM16 (0x8A)
+#define TCCR2A  _SFR_MEM8 (0xB0)
+#define TCCR2B  _SFR_MEM8 (0xB1)
+#define TCNT2   _SFR_MEM8 (0xB2)
+#define OCR2A   _SFR_MEM8 (0xB3)
+#define OCR2B   _SFR_MEM8 (0xB4)
+#define ASSR    _SFR_MEM8 (0xB6)
+#define UCSR0A  _SFR_MEM8 (0xC0)
+#define UCSR0B  _SFR_MEM8 (0xC1)
+#define UCSR0C  _SFR_MEM8 (0xC2)
+#define UBRR0L  _SFR_MEM8 (0xC4)
+#define UBRR0H  _SFR_MEM8 (0xC5)
+
+/* The data register is split: writes go to the transmitter, reads
+   come from the receiver (see host_udr0). */
+volatile uint8_t * host_udr0 (void);
+#define UDR0    (*host_udr0 ())
+
+/* Port bits */
+#define PORTB0 0
+#define PORTB1 1
+#define PORTB2 2
+#define PORTB3 3
+#define PORTB4 4
+#define PORTB5 5
+#define PORTD4 4
+#define PORTD5 5
+#define PORTD6 6
+#define PORTD7 7
+#define PINB0  0
+#define PINB1  1
+#define PINB2  2
+#define PIND4  4
+#define DDB0   0
+#define DDB1   1
+#define DDB2   2
+#define DDB3   3
+#define DDB4   4
+#define DDB5   5
+#define DDD4   4
+#define DDD5   5
+#define DDD6   6
+#define DDD7   7
+
+/* Timer 0 */
+#define WGM00  0
+#define WGM01  1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define CS00   0
+#define CS01   1
+#define CS02   2
+#define WGM02  3
+
+/* Timer 1 */
+#define WGM10  0
+#define WGM11  1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10   0
+#define CS11   1
+#define CS12   2
+#define WGM12  3
+#define WGM13  4
+#define ICES1  6
+#define ICNC1  7
+#define FOC1B  6
+#define FOC1A  7
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1  5
+#define TOV1   0
+#define OCF1A  1
+#define OCF1B  2
+#define ICF1   5
+
+/* Timer 2 */
+#define WGM20  0
+#define WGM21  1
+#define CS20   0
+#define CS21   1
+#define CS22   2
+#define WGM22  3
+#define TOIE2  0
+#define OCIE2A 1
+#define OCIE2B 2
+#define TOV2   0
+#define OCF2A  1
+#define OCF2B  2
+
+/* Pin change interrupts */
+#define PCIE0   0
+#define PCIE1   1
+#define PCIE2   2
+#define PCIF0   0
+#define PCIF1   1
+#define PCIF2   2
+#define PCINT20 4
+
+/* ADC */
+#define ADPS0  0
+#define ADPS1  1
+#define ADPS2  2
+#define ADIE   3
+#define ADIF   4
+#define ADATE  5
+#define ADSC   6
+#define ADEN   7
+#define MUX0   0
+#define MUX1   1
+#define MUX2   2
+#define MUX3   3
+#define ADLAR  5
+#define REFS0  6
+#define REFS1  7
+
+/* USART */
+#define MPCM0  0
+#define U2X0   1
+#define UPE0   2
+#define DOR0   3
+#define FE0    4
+#define UDRE0  5
+#define TXC0   6
+#define RXC0   7
+#define TXB80  0
+#define RXB80  1
+#define UCSZ02 2
+#define TXEN0  3
+#define RXEN0  4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCSZ00 1
+#define UCSZ01 2
+
+/* Sleep mode control */
+#define SE     0
+#define SM0    1
+#define SM1    2
+#define SM2    3
+
+/* Status register */
+#define SREG_I 7
+
+#endif
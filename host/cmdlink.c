@@ -0,0 +1,190 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Command channel client
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * A request is sent up to cmdlink_attempts times; an attempt ends
+ * when its reply comes in or after cmdlink_timeout_ms. Anything
+ * else on the line (the print output) is skipped.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cmdlink.h"
+
+#define cmdlink_attempts   3
+#define cmdlink_timeout_ms 500
+
+static double cmdlink_now (void) {
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief  Opens the serial port
+ * @param  link  link
+ * @param  path  device
+ * @return  0 on success, -1 on error (see errno)
+ */
+int cmdlink_open (cmdlink_t * link, const char * path) {
+    struct termios t;
+
+    link->fd = open (path, O_RDWR | O_NOCTTY);
+    if (link->fd < 0)
+        return -1;
+    if (tcgetattr (link->fd, &t) == 0) {
+        cfmakeraw (&t);
+        cfsetispeed (&t, B115200);
+        cfsetospeed (&t, B115200);
+        tcsetattr (link->fd, TCSANOW, &t);
+    }
+    link->sequence = 0;
+    link->length = 0;
+    link->escape = link->overflow = 0;
+    link->retries = 0;
+    return 0;
+}
+
+/**
+ * @brief  Closes the serial port
+ * @param  link  link
+ */
+void cmdlink_close (cmdlink_t * link) {
+    close (link->fd);
+    link->fd = -1;
+}
+
+static unsigned cmdlink_put (uint8_t * buf, unsigned n, uint8_t b) {
+    if (b == command_slip_end) {
+        buf [n ++] = command_slip_esc;
+        b = command_slip_esc_end;
+    } else if (b == command_slip_esc) {
+        buf [n ++] = command_slip_esc;
+        b = command_slip_esc_esc;
+    }
+    buf [n ++] = b;
+    return n;
+}
+
+/* Follows command_take in command.c; returns the length of a good frame */
+static unsigned cmdlink_take (cmdlink_t * link, uint8_t b) {
+    uint16_t crc = 0xFFFF;
+    unsigned n, i;
+
+    if (b == command_slip_end) {
+        n = link->length;
+        link->length = 0;
+        link->escape = 0;
+        if (link->overflow) {
+            link->overflow = 0;
+            return 0;
+        }
+        for (i = 0; i < n; i ++)
+            crc = command_crc (crc, link->frame [i]);
+        return n >= 7 && crc == 0 ? n - 2 : 0;
+    }
+    if (b == command_slip_esc) {
+        link->escape = 1;
+        return 0;
+    }
+    if (link->escape) {
+        link->escape = 0;
+        if (b == command_slip_esc_end)
+            b = command_slip_end;
+        else if (b == command_slip_esc_esc)
+            b = command_slip_esc;
+    }
+    if (link->length < sizeof (link->frame))
+        link->frame [link->length ++] = b;
+    else
+        link->overflow = 1;
+    return 0;
+}
+
+/**
+ * @brief  Sends a command and waits for the reply
+ * @param  link  link
+ * @param  code  command (command_code_type)
+ * @param  arg  16 bit argument, -1 for none
+ * @param  reply  reply
+ * @return  0 on success, -1 if there was no reply (errno is ETIMEDOUT)
+ *          or the line failed
+ */
+int cmdlink_send (cmdlink_t * link, uint8_t code, int arg, cmdlink_reply_t * reply) {
+    uint8_t data [command_request_max], frame [2 + 2 * command_request_max], in [64];
+    unsigned count = 0, length = 0, i, n;
+    uint16_t crc = 0xFFFF;
+    struct pollfd p;
+    double start, left;
+    int attempt;
+    ssize_t got;
+
+    data [count ++] = ++ link->sequence;
+    data [count ++] = code;
+    if (arg >= 0) {
+        data [count ++] = (uint8_t) arg;
+        data [count ++] = (uint8_t) (arg >> 8);
+    }
+    for (i = 0; i < count; i ++)
+        crc = command_crc (crc, data [i]);
+    data [count ++] = (uint8_t) (crc >> 8);
+    data [count ++] = (uint8_t) crc;
+    frame [length ++] = command_slip_end;
+    for (i = 0; i < count; i ++)
+        length = cmdlink_put (frame, length, data [i]);
+    frame [length ++] = command_slip_end;
+
+    for (attempt = 0; attempt < cmdlink_attempts; attempt ++) {
+        if (attempt != 0)
+            link->retries ++;
+        start = cmdlink_now ();
+        if (write (link->fd, frame, length) != (ssize_t) length)
+            return -1;
+        while ((left = start + cmdlink_timeout_ms * 1e-3 - cmdlink_now ()) > 0) {
+            p.fd = link->fd;
+            p.events = POLLIN;
+            if (poll (&p, 1, (int) (left * 1000) + 1) < 0 && errno != EINTR)
+                return -1;
+            got = read (link->fd, in, sizeof (in));
+            if (got < 0 && errno != EAGAIN && errno != EINTR)
+                return -1;
+            for (i = 0; got > 0 && i < (unsigned) got; i ++) {
+                n = cmdlink_take (link, in [i]);
+                if (n == 0 || link->frame [0] != link->sequence ||
+                    link->frame [1] != (code | command_reply_flag))
+                    continue;
+                reply->status = link->frame [2];
+                reply->latency = link->frame [3] | link->frame [4] << 8;
+                reply->has_value = n == 7;
+                reply->value = reply->has_value ? link->frame [5] | link->frame [6] << 8 : 0;
+                reply->round_trip = cmdlink_now () - start;
+                return 0;
+            }
+        }
+    }
+    errno = ETIMEDOUT;
+    return -1;
+}
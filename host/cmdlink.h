@@ -0,0 +1,57 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Command channel client interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Talks to the command task of the firmware (see command.h) over a
+ * serial port: the rover's /dev/ttyACM0 or the pseudo terminal of
+ * the host build (work/host/robot -p -R).
+ */
+#ifndef HOST_CMDLINK_H
+#define HOST_CMDLINK_H
+
+#include <stdint.h>
+
+#include "../command.h"
+
+typedef struct {
+    int fd;
+    uint8_t sequence;
+    /* Reply being received */
+    uint8_t frame [command_reply_max];
+    unsigned length;
+    int escape, overflow;
+    /* Replies that did not come or came broken */
+    unsigned retries;
+} cmdlink_t;
+
+typedef struct {
+    uint8_t status;
+    uint16_t latency;         /* us, as the firmware measured it */
+    uint16_t value;
+    int has_value;
+    double round_trip;        /* s, wall clock, the last attempt */
+} cmdlink_reply_t;
+
+int cmdlink_open (cmdlink_t * link, const char * path);
+void cmdlink_close (cmdlink_t * link);
+int cmdlink_send (cmdlink_t * link, uint8_t code, int arg, cmdlink_reply_t * reply);
+
+#endif
@@ -0,0 +1,612 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Simulated Atmega328p peripherals
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * --------------------------------------------------------
+ * Peripheral        | What is simulated
+ * ------------------|-------------------------------------
+ * Timer 1           | normal and CTC modes, compare A/B and overflow flags,
+ *                   | compare outputs OC1A (PB1) and OC1B (PB2)
+ * Timer 2           | normal and CTC modes, compare A/B and overflow flags
+ * ADC               | single and free running conversions, ADC interrupt
+ * USART 0           | transmitter and receiver at the programmed baud rate
+ * Pin change        | port D (PCINT16-23)
+ * Status register   | I bit, sei/cli
+ *
+ * Timer 0 is only used as a PWM source for the motors; the rover
+ * model reads its compare registers directly.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "../events.h"
+
+volatile uint8_t host_io [0x100] __attribute__ ((aligned (2)));
+
+/** @brief Simulated time in CPU cycles */
+uint64_t host_now;
+
+/** @brief What the CPU is doing right now (for the report) */
+host_cpu_t host_cpu;
+
+static uint64_t host_limit = 60 * (uint64_t) F_CPU;
+static int host_realtime;
+static struct timespec host_started;
+
+/* Firmware counters shown in the report, if the firmware has them */
+extern unsigned long ultrasonic_gate_count __attribute__ ((weak));
+extern unsigned long ultrasonic_gate_saved __attribute__ ((weak));
+
+static uint64_t cpu_cycles [host_cpu_kinds];
+static uint64_t cli_cycles, cli_start, cli_longest;
+
+/**
+ * @brief Interrupt vectors
+ *
+ * The handlers are weak so that a firmware that does not define
+ * some of them still links.
+ */
+#define HOST_VECTOR(name) void name (void) __attribute__ ((weak));
+#include "vectors.h"
+#undef HOST_VECTOR
+
+typedef struct {
+    const char * name;
+    void (* handler) (void);
+    uint8_t flag_reg, flag_bit, enable_reg, enable_bit, clear;
+    uint64_t raised, count, latency_sum, latency_max, cycles;
+} host_vector_t;
+
+/* In priority order. Level triggered sources do not clear their flag. */
+static host_vector_t vectors [] = {
+    { "PCINT2",       PCINT2_vect,       0x3B, PCIF2,  0x68, PCIE2,  1 },
+    { "TIMER2_COMPA", TIMER2_COMPA_vect, 0x37, OCF2A,  0x70, OCIE2A, 1 },
+    { "TIMER2_COMPB", TIMER2_COMPB_vect, 0x37, OCF2B,  0x70, OCIE2B, 1 },
+    { "TIMER2_OVF",   TIMER2_OVF_vect,   0x37, TOV2,   0x70, TOIE2,  1 },
+    { "TIMER1_CAPT",  TIMER1_CAPT_vect,  0x36, ICF1,   0x6F, ICIE1,  1 },
+    { "TIMER1_COMPA", TIMER1_COMPA_vect, 0x36, OCF1A,  0x6F, OCIE1A, 1 },
+    { "TIMER1_COMPB", TIMER1_COMPB_vect, 0x36, OCF1B,  0x6F, OCIE1B, 1 },
+    { "TIMER1_OVF",   TIMER1_OVF_vect,   0x36, TOV1,   0x6F, TOIE1,  1 },
+    { "USART_RX",     USART_RX_vect,     0xC0, RXC0,   0xC1, RXCIE0, 0 },
+    { "USART_UDRE",   USART_UDRE_vect,   0xC0, UDRE0,  0xC1, UDRIE0, 0 },
+    { "USART_TX",     USART_TX_vect,     0xC0, TXC0,   0xC1, TXCIE0, 1 },
+    { "ADC",          ADC_vect,          0x7A, ADIF,   0x7A, ADIE,   1 },
+};
+
+#define vectors_count (sizeof (vectors) / sizeof (vectors [0]))
+
+static host_vector_t * host_vector_now;
+static uint64_t host_dispatched;
+
+/* Timer 1 prescaler remainder and compare output levels */
+static uint32_t timer1_rest;
+static uint8_t oc1a, oc1b;
+
+/* Timer 2 prescaler remainder */
+static uint32_t timer2_rest;
+
+/* ADC conversion in progress */
+static uint64_t adc_done;
+static unsigned adc_conversions;
+static uint8_t adc_channel;
+
+/* USART */
+static int uart_in = -1, uart_out = -1;
+static uint8_t udr0_tx, udr0_rx, udr0_armed, tx_data, tx_full;
+static uint64_t tx_shift_end, rx_next;
+static unsigned long tx_bytes, rx_bytes, rx_overruns;
+static char tx_buf [256];
+static unsigned tx_buf_len;
+
+/* Port D pins as last seen by the pin change logic */
+static uint8_t pind_last;
+
+static void host_cli_track (void) {
+    int enabled = (SREG & _BV (SREG_I)) != 0;
+    if (! enabled && cli_start == 0)
+        cli_start = host_now + 1;
+    else if (enabled && cli_start != 0) {
+        uint64_t d = host_now + 1 - cli_start;
+        cli_cycles += d;
+        if (d > cli_longest)
+            cli_longest = d;
+        cli_start = 0;
+    }
+}
+
+static void timer1_output (uint8_t com, uint8_t * oc) {
+    switch (com) {
+      case 1:
+        * oc ^= 1;
+        break;
+      case 2:
+        * oc = 0;
+        break;
+      case 3:
+        * oc = 1;
+        break;
+    }
+}
+
+static void timer1_advance (uint32_t cycles) {
+    static const uint16_t prescalers [8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+    unsigned p = prescalers [TCCR1B & 7], wgm, top;
+    uint32_t ticks;
+
+    if (p == 0)
+        return;
+    timer1_rest += cycles;
+    ticks = timer1_rest / p;
+    timer1_rest %= p;
+    wgm = (TCCR1A & 3) | ((TCCR1B >> WGM12) & 3) << 2;
+    top = wgm == 4 ? OCR1A : wgm == 12 ? ICR1 : 0xFFFF;
+    while (ticks --) {
+        if (TCNT1 == OCR1A) {
+            TIFR1 |= _BV (OCF1A);
+            timer1_output (TCCR1A >> COM1A0 & 3, &oc1a);
+        }
+        if (TCNT1 == OCR1B) {
+            TIFR1 |= _BV (OCF1B);
+            timer1_output (TCCR1A >> COM1B0 & 3, &oc1b);
+        }
+        if (TCNT1 == top) {
+            TCNT1 = 0;
+            if (wgm == 0)
+                TIFR1 |= _BV (TOV1);
+            else if (wgm == 12)
+                TIFR1 |= _BV (ICF1);
+        } else
+            TCNT1 ++;
+    }
+}
+
+static void timer2_advance (uint32_t cycles) {
+    static const uint16_t prescalers [8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+    unsigned p = prescalers [TCCR2B & 7], top;
+    uint32_t ticks;
+
+    if (p == 0)
+        return;
+    timer2_rest += cycles;
+    ticks = timer2_rest / p;
+    timer2_rest %= p;
+    top = (TCCR2A & _BV (WGM21)) ? OCR2A : 0xFF;
+    while (ticks --) {
+        if (TCNT2 == OCR2A)
+            TIFR2 |= _BV (OCF2A);
+        if (TCNT2 == OCR2B)
+            TIFR2 |= _BV (OCF2B);
+        if (TCNT2 == top) {
+            TCNT2 = 0;
+            if (top == 0xFF)
+                TIFR2 |= _BV (TOV2);
+        } else
+            TCNT2 ++;
+    }
+}
+
+static void adc_start (void) {
+    /* The input is latched when the conversion starts. It takes 13 ADC
+       cycles, 25 for the very first conversion. */
+    adc_channel = ADMUX & 0x0F;
+    adc_done = host_now + (uint64_t) (1 << (ADCSRA & 7 ? ADCSRA & 7 : 1)) *
+        (adc_conversions ++ == 0 ? 25 : 13);
+}
+
+static void adc_advance (void) {
+    uint16_t v;
+
+    if (! (ADCSRA & _BV (ADEN))) {
+        adc_done = 0;
+        return;
+    }
+    if (adc_done == 0) {
+        if (ADCSRA & _BV (ADSC))
+            adc_start ();
+        return;
+    }
+    if (host_now < adc_done)
+        return;
+    v = world_adc (adc_channel);
+    if (ADMUX & _BV (ADLAR))
+        v <<= 6;
+    ADCW = v;
+    ADCSRA |= _BV (ADIF);
+    adc_done = 0;
+    if (ADCSRA & _BV (ADATE))
+        /* Free running: the next conversion starts right away */
+        adc_start ();
+    else
+        ADCSRA &= ~_BV (ADSC);
+}
+
+static void uart_flush (void) {
+    if (tx_buf_len != 0 && uart_out >= 0)
+        if (write (uart_out, tx_buf, tx_buf_len) < 0 && errno != EAGAIN)
+            uart_out = -1;
+    tx_buf_len = 0;
+}
+
+static uint64_t uart_frame (void) {
+    unsigned ubrr = (unsigned) UBRR0H << 8 | UBRR0L;
+    return (uint64_t) 10 * ((UCSR0A & _BV (U2X0)) ? 8 : 16) * (ubrr + 1);
+}
+
+static void uart_latch (void) {
+    if (! udr0_armed)
+        return;
+    udr0_armed = 0;
+    if (! (UCSR0B & _BV (TXEN0)))
+        return;
+    tx_data = udr0_tx;
+    tx_full = 1;
+    UCSR0A &= ~_BV (UDRE0);
+}
+
+static void uart_advance (void) {
+    uint8_t b;
+
+    uart_latch ();
+    if (host_now >= tx_shift_end) {
+        if (tx_full) {
+            tx_full = 0;
+            tx_shift_end = host_now + uart_frame ();
+            tx_buf [tx_buf_len ++] = (char) tx_data;
+            tx_bytes ++;
+            if (tx_buf_len == sizeof (tx_buf) || tx_data == '\n')
+                uart_flush ();
+            UCSR0A &= ~_BV (TXC0);
+        } else if (tx_shift_end != 0) {
+            tx_shift_end = 0;
+            UCSR0A |= _BV (TXC0);
+            /* The line went idle: binary data (replies, records) do
+               not end with a new line */
+            uart_flush ();
+        }
+    }
+    if (! tx_full)
+        UCSR0A |= _BV (UDRE0);
+
+    if (uart_in < 0 || host_now < rx_next || ! (UCSR0B & _BV (RXEN0)))
+        return;
+    rx_next = host_now + uart_frame ();
+    if (read (uart_in, &b, 1) != 1)
+        return;
+    rx_bytes ++;
+    if (UCSR0A & _BV (RXC0)) {
+        UCSR0A |= _BV (DOR0);
+        rx_overruns ++;
+        return;
+    }
+    udr0_rx = b;
+    UCSR0A |= _BV (RXC0);
+}
+
+static void pins_advance (void) {
+    uint8_t pind;
+
+    PINB = PORTB & DDRB;
+    /* Compare outputs override the port */
+    if (TCCR1A & (_BV (COM1A1) | _BV (COM1A0)))
+        PINB = (PINB & ~_BV (PORTB1)) | (oc1a && (DDRB & _BV (DDB1)) ? _BV (PORTB1) : 0);
+    if (TCCR1A & (_BV (COM1B1) | _BV (COM1B0)))
+        PINB = (PINB & ~_BV (PORTB2)) | (oc1b && (DDRB & _BV (DDB2)) ? _BV (PORTB2) : 0);
+    pind = (PORTD & DDRD) | (world_pind () & ~DDRD);
+    PIND = pind;
+    if ((pind ^ pind_last) & PCMSK2)
+        PCIFR |= _BV (PCIF2);
+    pind_last = pind;
+}
+
+static void host_dispatch (void) {
+    unsigned i;
+    host_vector_t * v;
+    host_cpu_t cpu;
+    uint64_t start;
+
+    for (i = 0; i < vectors_count; i ++) {
+        v = & vectors [i];
+        if (! (host_io [v->flag_reg] & _BV (v->flag_bit)) ||
+            ! (host_io [v->enable_reg] & _BV (v->enable_bit))) {
+            v->raised = 0;
+            continue;
+        }
+        if (v->raised == 0)
+            v->raised = host_now + 1;
+    }
+    if (! (SREG & _BV (SREG_I)) || host_vector_now != 0)
+        return;
+    for (i = 0; i < vectors_count; i ++) {
+        v = & vectors [i];
+        if (v->raised == 0 || v->handler == 0)
+            continue;
+        if (v->clear)
+            host_io [v->flag_reg] &= ~_BV (v->flag_bit);
+        v->count ++;
+        host_dispatched ++;
+        v->latency_sum += host_now + 1 - v->raised;
+        if (host_now + 1 - v->raised > v->latency_max)
+            v->latency_max = host_now + 1 - v->raised;
+        v->raised = 0;
+        cpu = host_cpu;
+        host_cpu = host_cpu_isr;
+        host_vector_now = v;
+        start = host_now;
+        SREG &= ~_BV (SREG_I);
+        host_advance (host_isr_cycles);
+        v->handler ();
+        SREG |= _BV (SREG_I);
+        host_vector_now = 0;
+        uart_latch ();
+        v->cycles += host_now - start;
+        host_cpu = cpu;
+        /* One handler at a time: the chip executes at least one
+           instruction of the main program after every reti. */
+        return;
+    }
+}
+
+static void host_pace (void) {
+    struct timespec now, d;
+    double ahead;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    ahead = (double) host_now / F_CPU -
+        ((now.tv_sec - host_started.tv_sec) + (now.tv_nsec - host_started.tv_nsec) / 1e9);
+    if (ahead <= 0)
+        return;
+    d.tv_sec = (time_t) ahead;
+    d.tv_nsec = (long) ((ahead - d.tv_sec) * 1e9);
+    nanosleep (&d, 0);
+}
+
+/**
+ * @brief  Moves simulated time forward
+ * @param  cycles  number of CPU cycles
+ *
+ * The time is advanced in small slices so that peripheral events and
+ * interrupts land within a microsecond of where they belong.
+ */
+void host_advance (uint32_t cycles) {
+    uint32_t n;
+
+    while (cycles != 0) {
+        n = cycles < host_cycles_per_us ? cycles : host_cycles_per_us;
+        cycles -= n;
+        host_cli_track ();
+        host_now += n;
+        cpu_cycles [host_cpu] += n;
+        timer1_advance (n);
+        timer2_advance (n);
+        adc_advance ();
+        uart_advance ();
+        pins_advance ();
+        world_step ();
+        if (host_realtime && host_now % (F_CPU / 1000) < n)
+            host_pace ();
+        if (host_now >= host_limit)
+            host_finish (0);
+        host_dispatch ();
+    }
+}
+
+/**
+ * @brief  Accesses a register
+ * @param  addr  data space address
+ * @return  register location
+ */
+volatile uint8_t * host_reg (unsigned addr) {
+    host_advance (host_access_cycles);
+    return & host_io [addr];
+}
+
+/**
+ * @brief  Accesses a 16 bit register
+ * @param  addr  data space address of the low byte
+ * @return  register location
+ */
+volatile uint16_t * host_reg16 (unsigned addr) {
+    host_advance (host_access_cycles);
+    return (volatile uint16_t *) & host_io [addr];
+}
+
+/**
+ * @brief  Accesses the USART data register
+ *
+ * The firmware only reads UDR0 from the receive interrupt handler, so
+ * any other access is taken as a write to the transmitter. Reading
+ * the register clears the receive complete flag.
+ * @return  receiver or transmitter data location
+ */
+volatile uint8_t * host_udr0 (void) {
+    host_advance (host_access_cycles);
+    if (host_vector_now != 0 && host_vector_now->handler == USART_RX_vect) {
+        UCSR0A &= ~(_BV (RXC0) | _BV (DOR0));
+        return & udr0_rx;
+    }
+    udr0_armed = 1;
+    return & udr0_tx;
+}
+
+/** @brief Enables interrupts */
+void sei (void) {
+    SREG |= _BV (SREG_I);
+    host_advance (1);
+}
+
+/** @brief Disables interrupts */
+void cli (void) {
+    SREG &= ~_BV (SREG_I);
+    host_advance (1);
+}
+
+/**
+ * @brief  Spins for a given time
+ * @param  us  time in microseconds
+ */
+void host_delay_us (double us) {
+    host_cpu_t cpu = host_cpu;
+
+    if (cpu == host_cpu_task)
+        host_cpu = host_cpu_busy;
+    host_advance ((uint32_t) (us * host_cycles_per_us));
+    host_cpu = cpu;
+}
+
+/** @brief Executes the sleep instruction */
+void sleep_cpu (void) {
+    uint64_t n;
+
+    if (! (SMCR & _BV (SE)))
+        return;
+    if ((SMCR & (_BV (SM2) | _BV (SM1) | _BV (SM0))) == _BV (SM1)) {
+        fprintf (stderr, "host: power down at %.3f s\n", (double) host_now / F_CPU);
+        host_finish (2);
+    }
+    /* Idle: wait for the next interrupt */
+    n = host_dispatched;
+    while (host_dispatched == n)
+        host_advance (host_access_cycles);
+}
+
+/**
+ * @brief  Sets the simulation length
+ * @param  seconds  simulated time to run for
+ * @param  realtime  if not 0, never run ahead of the wall clock
+ */
+void host_set_limit (double seconds, int realtime) {
+    host_limit = (uint64_t) (seconds * F_CPU);
+    host_realtime = realtime;
+    clock_gettime (CLOCK_MONOTONIC, &host_started);
+}
+
+/**
+ * @brief  Connects the USART to the outside world
+ * @param  in  file to receive from (0 - nothing)
+ * @param  out  file to transmit to (0 - standard output)
+ * @param  pty  if not 0, use a pseudo terminal for both directions
+ */
+void host_uart_open (const char * in, const char * out, int pty) {
+    struct termios t;
+    int slave;
+
+    if (pty) {
+        uart_in = posix_openpt (O_RDWR | O_NOCTTY);
+        if (uart_in < 0 || grantpt (uart_in) < 0 || unlockpt (uart_in) < 0) {
+            perror ("host: pty");
+            exit (1);
+        }
+        /* Keep the slave open so that the master does not see a
+           hangup while nobody is connected. */
+        slave = open (ptsname (uart_in), O_RDWR | O_NOCTTY);
+        if (slave >= 0 && tcgetattr (slave, &t) == 0) {
+            cfmakeraw (&t);
+            tcsetattr (slave, TCSANOW, &t);
+        }
+        fcntl (uart_in, F_SETFL, O_NONBLOCK);
+        uart_out = uart_in;
+        fprintf (stderr, "host: uart on %s\n", ptsname (uart_in));
+        return;
+    }
+    if (in != 0) {
+        uart_in = open (in, O_RDONLY | O_NONBLOCK);
+        if (uart_in < 0) {
+            perror (in);
+            exit (1);
+        }
+    }
+    uart_out = 1;
+    if (out != 0) {
+        uart_out = open (out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (uart_out < 0) {
+            perror (out);
+            exit (1);
+        }
+    }
+}
+
+/**
+ * @brief  Prints the CPU and interrupt report
+ * @param  f  output stream
+ */
+void host_report (FILE * f) {
+    struct timespec now;
+    double wall, sim = (double) host_now / F_CPU, us = (double) host_cycles_per_us;
+    unsigned i;
+    host_vector_t * v;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    wall = (now.tv_sec - host_started.tv_sec) + (now.tv_nsec - host_started.tv_nsec) / 1e9;
+    if (sim == 0)
+        return;
+    fprintf (f, "host: simulated %.3f s in %.3f s (%.1fx real time)\n",
+             sim, wall, wall > 0 ? sim / wall : 0);
+    fprintf (f, "host: cpu: task %.2f%%, busy wait %.2f%%, isr %.2f%%, scheduler %.2f%%\n",
+             100.0 * cpu_cycles [host_cpu_task] / host_now,
+             100.0 * cpu_cycles [host_cpu_busy] / host_now,
+             100.0 * cpu_cycles [host_cpu_isr] / host_now,
+             100.0 * cpu_cycles [host_cpu_sched] / host_now);
+    fprintf (f, "host: interrupts disabled %.2f%%, longest %.1f us\n",
+             100.0 * cli_cycles / host_now, cli_longest / us);
+    fprintf (f, "host: scheduler: %.0f passes/s, %.0f wait evaluations/s\n",
+             host_passes / sim, host_wait_evals / sim);
+    fprintf (f, "host: %-14s %9s %12s %12s %12s\n", "vector", "count", "latency us", "max us", "time us");
+    for (i = 0; i < vectors_count; i ++) {
+        v = & vectors [i];
+        if (v->count == 0)
+            continue;
+        fprintf (f, "host: %-14s %9llu %12.1f %12.1f %12.1f\n", v->name,
+                 (unsigned long long) v->count, v->latency_sum / us / v->count,
+                 v->latency_max / us, v->cycles / us / v->count);
+    }
+    fprintf (f, "host: uart: tx %lu bytes, rx %lu bytes, rx overruns %lu\n",
+             tx_bytes, rx_bytes, rx_overruns);
+    if (& ultrasonic_gate_count != 0 && & ultrasonic_gate_saved != 0)
+        fprintf (f, "host: firmware: ultrasonic gate %lu times, saved %.1f ms\n",
+                 ultrasonic_gate_count, ultrasonic_gate_saved / 1e3);
+#ifdef EVENT_STATS
+    for (i = 1; i < events_count; i ++)
+        fprintf (f, "host: event %-13s %9lu wake-ups, %9lu flag tests\n",
+                 event_names [i], event_wakeups [i], event_tests [i]);
+#endif
+    world_report (f);
+}
+
+/**
+ * @brief  Ends the simulation
+ * @param  status  process exit status
+ */
+void host_finish (int status) {
+    static int finishing;
+
+    if (finishing ++)
+        return;
+    uart_flush ();
+    host_report (stderr);
+    exit (status);
+}
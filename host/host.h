@@ -0,0 +1,85 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Host simulator internal interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Simulated time is counted in CPU cycles (F_CPU per second). Time
+ * only moves when the firmware touches a register, spins in a delay,
+ * runs an interrupt handler or gives control to the scheduler; each
+ * of these is charged a fixed number of cycles, so the report is an
+ * estimate of where the CPU goes rather than a cycle exact trace.
+ */
+#ifndef HOST_HOST_H
+#define HOST_HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "avr/io.h"
+
+/* Inside the simulator register names refer to the raw register
+   file and do not advance the time. */
+#undef _SFR_MEM8
+#undef _SFR_MEM16
+#define _SFR_MEM8(a)  (host_io [(a)])
+#define _SFR_MEM16(a) (* (volatile uint16_t *) &host_io [(a)])
+
+#define host_cycles_per_us  (F_CPU / 1000000UL)
+
+/* Cycle charges */
+#define host_access_cycles  2   /* a register access and the code around it */
+#define host_isr_cycles     40  /* interrupt entry, prologue and epilogue */
+#define host_switch_cycles  40  /* one scheduler step */
+
+/* Where the cycles go */
+typedef enum {
+    host_cpu_task,
+    host_cpu_busy,
+    host_cpu_isr,
+    host_cpu_sched,
+    host_cpu_kinds
+} host_cpu_t;
+
+/* Register file, indexed by data space address */
+extern volatile uint8_t host_io [0x100];
+extern uint64_t host_now;
+extern host_cpu_t host_cpu;
+
+void host_advance (uint32_t cycles);
+void host_finish (int status);
+void host_report (FILE * f);
+void host_uart_open (const char * in, const char * out, int pty);
+void host_set_limit (double seconds, int realtime);
+
+/* Rover and surroundings model (world.c) */
+void world_load (const char * path);
+void world_set_gain (double left, double right);
+void world_set_trace (const char * path);
+void world_step (void);
+uint8_t world_pind (void);
+uint16_t world_adc (uint8_t channel);
+void world_report (FILE * f);
+
+/* Scheduler (synthos.c) */
+extern unsigned long host_passes, host_wait_evals;
+extern void (* const host_tasks []) (void);
+extern const char * const host_task_names [];
+
+#endif
@@ -0,0 +1,217 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Binary log decoder
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Turns the records a PRINT_BINARY firmware sends (see print.h) back
+ * into text. The format strings are taken from the firmware image
+ * (work/robot.out or work/host/robot) by their addresses. On the AVR
+ * the variables are at 0x800000 and up in the image; the addresses
+ * that are not in the image as they are are looked up there.
+ *
+ *     logdecode work/robot.out < /dev/ttyACM0
+ *
+ * Every line is prefixed with the time of the record in seconds
+ * since the start of the firmware.
+ */
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../print.h"
+
+#define avr_data_base 0x800000
+
+typedef struct {
+    uint64_t address, size, offset;
+} segment_t;
+
+static unsigned char * image;
+static long image_size;
+static segment_t * segments;
+static unsigned segments_count;
+
+static void fail (const char * msg, const char * arg) {
+    fprintf (stderr, "logdecode: %s%s\n", msg, arg);
+    exit (1);
+}
+
+static void add_segment (uint64_t address, uint64_t size, uint64_t offset) {
+    if (offset + size > (uint64_t) image_size)
+        fail ("bad section in the image", "");
+    segments = realloc (segments, (segments_count + 1) * sizeof (segment_t));
+    segments [segments_count].address = address;
+    segments [segments_count].size = size;
+    segments [segments_count].offset = offset;
+    segments_count ++;
+}
+
+/* Takes the sections that have contents in memory */
+static void load_image (const char * path) {
+    FILE * f = fopen (path, "rb");
+    unsigned i;
+
+    if (f == 0)
+        fail ("cannot open ", path);
+    fseek (f, 0, SEEK_END);
+    image_size = ftell (f);
+    rewind (f);
+    image = malloc (image_size);
+    if (fread (image, 1, image_size, f) != (size_t) image_size)
+        fail ("cannot read ", path);
+    fclose (f);
+    if (image_size < EI_NIDENT || memcmp (image, ELFMAG, SELFMAG) != 0)
+        fail ("not an ELF file: ", path);
+
+    if (image [EI_CLASS] == ELFCLASS32) {
+        Elf32_Ehdr * h = (Elf32_Ehdr *) image;
+        Elf32_Shdr * s = (Elf32_Shdr *) (image + h->e_shoff);
+
+        for (i = 0; i < h->e_shnum; i ++)
+            if ((s [i].sh_flags & SHF_ALLOC) && s [i].sh_type != SHT_NOBITS)
+                add_segment (s [i].sh_addr, s [i].sh_size, s [i].sh_offset);
+    } else {
+        Elf64_Ehdr * h = (Elf64_Ehdr *) image;
+        Elf64_Shdr * s = (Elf64_Shdr *) (image + h->e_shoff);
+
+        for (i = 0; i < h->e_shnum; i ++)
+            if ((s [i].sh_flags & SHF_ALLOC) && s [i].sh_type != SHT_NOBITS)
+                add_segment (s [i].sh_addr, s [i].sh_size, s [i].sh_offset);
+    }
+}
+
+static const char * lookup (uint64_t address) {
+    unsigned i, pass;
+
+    for (pass = 0; pass < 2; pass ++, address += avr_data_base)
+        for (i = 0; i < segments_count; i ++)
+            if (address >= segments [i].address &&
+                address < segments [i].address + segments [i].size &&
+                memchr (image + segments [i].offset + (address - segments [i].address), 0,
+                        segments [i].size - (address - segments [i].address)) != 0)
+                return (const char *) image + segments [i].offset + (address - segments [i].address);
+    return 0;
+}
+
+static int number (uint64_t * v) {
+    int c, shift = 0;
+
+    * v = 0;
+    do {
+        if ((c = getchar ()) == EOF)
+            return 0;
+        * v |= (uint64_t) (c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return 1;
+}
+
+/* Follows print () in print.c */
+static void render (const char * s, int64_t * args) {
+    char spec [16];
+    const char * ss, * xs;
+    int64_t * p = args;
+    unsigned w;
+    char c;
+
+    while ((c = *s ++) != 0) {
+        if (c != '%') {
+            putchar (c);
+            continue;
+        }
+        ss = s;
+        c = *s ++;
+        if (c == '%') {
+            putchar ('%');
+            continue;
+        }
+        w = 0;
+        while (c >= '0' && c <= '9') {
+            w = c - '0';
+            c = *s ++;
+        }
+        if (c == 'l')
+            c = *s ++;
+        snprintf (spec, sizeof (spec), "%%%s%ull%c", *ss == '0' ? "0" : "", w, c == 'i' ? 'd' : c);
+        switch (c) {
+          case 'u':
+          case 'x':
+          case 'X':
+            printf (spec, (unsigned long long) (uint32_t) *p ++);
+            break;
+          case 'd':
+          case 'i':
+            printf (spec, (long long) *p ++);
+            break;
+          case 'c':
+            printf ("%*c", w, (char) *p ++);
+            break;
+          case 's':
+            xs = lookup ((uint64_t) *p ++);
+            printf ("%*s", w, xs != 0 ? xs : "?");
+            break;
+          default:
+            putchar ('%');
+            s = ss;
+        }
+    }
+}
+
+int main (int argc, char ** argv) {
+    uint64_t v, fmt, time = 0;
+    int64_t args [3];
+    const char * s;
+    int c, i, line = 1;
+
+    if (argc != 2) {
+        fprintf (stderr, "usage: %s firmware < log\n", argv [0]);
+        return 1;
+    }
+    load_image (argv [1]);
+
+    while ((c = getchar ()) != EOF) {
+        if ((c & ~3) != print_record_mark) {
+            /* Not in step, look for the next record */
+            continue;
+        }
+        if (! number (&fmt) || ! number (&v))
+            break;
+        time += v;
+        args [0] = args [1] = args [2] = 0;
+        for (i = 0; i < (c & 3); i ++) {
+            if (! number (&v))
+                return 0;
+            args [i] = (int64_t) (v >> 1) ^ - (int64_t) (v & 1);
+        }
+        s = lookup (fmt);
+        if (s == 0) {
+            /* Not a record after all */
+            continue;
+        }
+        if (line)
+            printf ("%10.3f ", time * 1.024e-3);
+        render (s, args);
+        line = s [0] != 0 && s [strlen (s) - 1] == '\n';
+        fflush (stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Number formatting check and benchmark for print.c
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Builds print.c by itself, against a UART that takes everything, and
+ * compares what print_render makes with snprintf:
+ *
+ *     work/host/printtest        (make printtest)
+ *
+ * goes over the edge values and random numbers of every length in
+ * every conversion, alone and three in a message, and exits with 1 if
+ * anything does not match.
+ *
+ *     work/host/printtest -b     (make printbench)
+ *
+ * times print_render on typical messages and prints the time and the
+ * host clock cycles per call.
+ *
+ * Where print differs from printf on purpose, the reference follows
+ * print: the width is one digit, and the padding of %d counts the
+ * digits only, after the sign.
+ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "../print.c"
+
+/* The UART print () would write to, always empty */
+volatile uint8_t uart_send_put, uart_send_get;
+
+uint8_t uart_put_bytes (const uint8_t * buf, uint8_t n) {
+    (void) buf;
+    return n;
+}
+
+/* What a waiting print () needs, with PRINT_LOSSY set to 0 */
+volatile uint8_t events [events_count];
+#ifdef EVENT_STATS
+unsigned long event_wakeups [events_count], event_tests [events_count];
+#endif
+unsigned long host_wait_evals;
+
+void host_yield (void) {
+}
+
+/* Conversions: fill and width, and the letter */
+static const char * const specs [] = {
+    "", "1", "5", "9", "05", "09"
+};
+static const char * const convs [] = {
+    "u", "d", "i", "x", "X", "lu", "ld", "lx"
+};
+
+#define specs_count (sizeof (specs) / sizeof (specs [0]))
+#define convs_count (sizeof (convs) / sizeof (convs [0]))
+
+static const unsigned long edges [] = {
+    0, 1, 9, 10, 99, 100, 255, 256, 9999, 10000, 65535, 65536, 99999, 100000,
+    0x7FFFFFFFUL, 0x80000000UL, 999999999UL, 1000000000UL, 0xFFFFFFFFUL,
+#if ULONG_MAX > 0xFFFFFFFFUL
+    0x100000000UL, 9999999999UL, 10000000000UL, 0x7FFFFFFFFFFFFFFFUL,
+    9999999999999999999UL, 10000000000000000000UL,
+#endif
+    ULONG_MAX
+};
+
+#define edges_count (sizeof (edges) / sizeof (edges [0]))
+
+static unsigned long seed = 88172645463325252UL;
+
+static unsigned long next_random (void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+/* A number of 0 to all bits, so every length shows up */
+static unsigned long random_value (void) {
+    unsigned bits = next_random () % (sizeof (long) * 8 + 1);
+
+    return bits == 0 ? 0 : next_random () >> (sizeof (long) * 8 - bits);
+}
+
+/**
+ * @brief  Makes a conversion and what print has to render for it
+ * @param  fmt  gets the conversion
+ * @param  out  gets the text, the end of it
+ * @param  spec  fill and width
+ * @param  conv  conversion
+ * @param  v  argument
+ * @return  end of out
+ */
+static char * reference (char * fmt, char * out, const char * spec, const char * conv, long v) {
+    char f [16], c = conv [strlen (conv) - 1];
+    unsigned long u = (unsigned long) v;
+
+    sprintf (fmt, "%%%s%s", spec, conv);
+    if ((c == 'd' || c == 'i') && v < 0) {
+        * out ++ = '-';
+        u = 0UL - u;
+    }
+    sprintf (f, "%%%sl%c", spec, c == 'd' || c == 'i' ? 'u' : c);
+    return out + sprintf (out, f, u);
+}
+
+/* Cases and mismatches */
+static unsigned long checked, failed;
+
+static void compare (const char * fmt, const char * expected, long a1, long a2, long a3) {
+    uint8_t buf [print_message_max + 1];
+    size_t n = strlen (expected);
+    uint8_t len;
+
+    if (n > print_message_max)
+        n = print_message_max;
+    len = print_render (buf, (long) (uintptr_t) fmt, a1, a2, a3);
+    checked ++;
+    if (len == n && memcmp (buf, expected, n) == 0)
+        return;
+    /* The first few tell enough */
+    if (failed ++ >= 10)
+        return;
+    buf [len] = 0;
+    fprintf (stderr, "printtest: \"%s\" with %ld %ld %ld: \"%s\", expected \"%.*s\"\n",
+             fmt, a1, a2, a3, (char *) buf, (int) n, expected);
+}
+
+/* One conversion */
+static void check_one (unsigned long v) {
+    char fmt [16], out [64];
+    unsigned i, j;
+    char c;
+
+    for (i = 0; i < specs_count; i ++)
+        for (j = 0; j < convs_count; j ++) {
+            * reference (fmt, out, specs [i], convs [j], (long) v) = 0;
+            compare (fmt, out, (long) v, 0, 0);
+            c = convs [j][strlen (convs [j]) - 1];
+            if (c == 'd' || c == 'i') {
+                * reference (fmt, out, specs [i], convs [j], - (long) v) = 0;
+                compare (fmt, out, - (long) v, 0, 0);
+            }
+        }
+}
+
+/* Three conversions in a message, with text around */
+static void check_three (long a1, long a2, long a3) {
+    char fmt [64], out [128], * f = fmt, * o = out;
+    long args [3];
+    unsigned i, spec, conv;
+
+    args [0] = a1;
+    args [1] = a2;
+    args [2] = a3;
+    f += sprintf (f, "x=");
+    o += sprintf (o, "x=");
+    for (i = 0; i < 3; i ++) {
+        spec = next_random () % specs_count;
+        conv = next_random () % convs_count;
+        o = reference (f, o, specs [spec], convs [conv], args [i]);
+        f += strlen (f);
+        * f ++ = * o ++ = i < 2 ? ' ' : '.';
+    }
+    * f = * o = 0;
+    compare (fmt, out, a1, a2, a3);
+}
+
+static int check (void) {
+    unsigned long i;
+    unsigned j;
+
+    for (i = 0; i < edges_count; i ++) {
+        check_one (edges [i]);
+        /* The neighbours of the edges */
+        check_one (edges [i] - 1);
+        check_one (edges [i] + 1);
+    }
+    for (i = 0; i < 50000; i ++)
+        check_one (random_value ());
+    for (i = 0; i < 50000; i ++)
+        check_one (next_random () & 0xFFFF);
+    for (i = 0; i < 50000; i ++) {
+        j = next_random () % edges_count;
+        check_three ((long) random_value (), (long) edges [j], (long) (next_random () & 0xFFFF));
+    }
+
+    printf ("printtest: %lu cases, %lu mismatches\n", checked, failed);
+    return failed != 0;
+}
+
+/* Typical messages, see robot.c and motors.c */
+static const struct {
+    const char * name, * fmt;
+    long a1, a2, a3;
+} benches [] = {
+    { "text only",      "robot: forward\n",          0, 0, 0 },
+    { "one short %u",   "robot: stop, got %u\n",     27, 0, 0 },
+    { "%u %u",          "motors: left speed: %u %u\n", 349, 86, 0 },
+    { "long %lu",       "time %lu us\n",             123456789, 0, 0 },
+    { "negative %d",    "turn %d\n",                 -1200, 0, 0 },
+    { "hex %04x %x",    "eyes %04x %x\n",            0x0b, 0xdeadbeef, 0 },
+};
+
+/* time.h does not go with the clock of timer.h */
+static double now_ns (void) {
+    struct timeval t;
+
+    gettimeofday (&t, 0);
+    return t.tv_sec * 1e9 + t.tv_usec * 1e3;
+}
+
+static void bench (void) {
+    uint8_t buf [print_message_max];
+    unsigned long i, calls = 2000000, sink = 0;
+    unsigned j;
+    double start, ns;
+#if defined (__x86_64__) || defined (__i386__)
+    unsigned long long cycles;
+#endif
+
+    for (j = 0; j < sizeof (benches) / sizeof (benches [0]); j ++) {
+        start = now_ns ();
+#if defined (__x86_64__) || defined (__i386__)
+        cycles = __builtin_ia32_rdtsc ();
+#endif
+        for (i = 0; i < calls; i ++)
+            sink += print_render (buf, (long) (uintptr_t) benches [j].fmt,
+                                  benches [j].a1 + (long) (i & 7), benches [j].a2, benches [j].a3);
+        ns = (now_ns () - start) / calls;
+        printf ("printbench: %-14s %6.1f ns/call", benches [j].name, ns);
+#if defined (__x86_64__) || defined (__i386__)
+        printf (", %6.1f tsc cycles/call", (double) (__builtin_ia32_rdtsc () - cycles) / calls);
+#endif
+        printf ("\n");
+    }
+    if (sink == 0)
+        printf ("\n");
+}
+
+int main (int argc, char ** argv) {
+    if (argc == 2 && strcmp (argv [1], "-b") == 0) {
+        bench ();
+        return 0;
+    }
+    if (argc != 1) {
+        fprintf (stderr, "usage: %s [-b]\n", argv [0]);
+        return 2;
+    }
+    return check ();
+}
@@ -0,0 +1,147 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         SynthOS scheduler stand-in and entry point of the host build
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Every loop task gets its own stack. The scheduler visits the tasks
+ * round robin; a task runs until it calls SynthOS_wait with a false
+ * condition or SynthOS_sleep. Every visit is charged
+ * host_switch_cycles, which stands for the time the SynthOS
+ * scheduler spends checking a task.
+ *
+ * The list of loop tasks (host_tasks) is generated from project.sop
+ * by the makefile.
+ */
+#include <setjmp.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "host.h"
+
+#define host_stack_size  (64 * 1024)
+
+typedef struct {
+    ucontext_t start;
+    jmp_buf resume;
+    int started;
+} host_task_t;
+
+/** @brief Number of times a task gave control back to the scheduler */
+unsigned long host_passes;
+
+/** @brief Number of SynthOS_wait condition evaluations */
+unsigned long host_wait_evals;
+
+static host_task_t * tasks;
+static unsigned tasks_count, current;
+static jmp_buf scheduler;
+
+void enable_ints (void);
+
+static void host_task_entry (void) {
+    host_tasks [current] ();
+    fprintf (stderr, "host: loop task %s returned\n", host_task_names [current]);
+    host_finish (1);
+}
+
+/**
+ * @brief  Gives control back to the scheduler
+ */
+void host_yield (void) {
+    host_passes ++;
+    if (_setjmp (tasks [current].resume) == 0)
+        _longjmp (scheduler, 1);
+}
+
+static void usage (const char * name) {
+    fprintf (stderr,
+             "usage: %s [options]\n"
+             "  -t seconds   simulated time to run (default 60)\n"
+             "  -R           do not run ahead of the wall clock\n"
+             "  -w file      world file (default: 400 x 300 cm box)\n"
+             "  -i file      feed the UART receiver from a file\n"
+             "  -o file      write the UART output to a file (default: standard output)\n"
+             "  -p           connect the UART to a pseudo terminal\n"
+             "  -l percent   left motor efficiency (default 100)\n"
+             "  -r percent   right motor efficiency (default 100)\n"
+             "  -s seed      random seed\n"
+             "  -T file      write the rover pose every 100 ms\n",
+             name);
+    exit (1);
+}
+
+int main (int argc, char ** argv) {
+    const char * in = 0, * out = 0, * world = 0;
+    double seconds = 60, l = 100, r = 100;
+    int c, pty = 0, realtime = 0;
+    host_task_t * t;
+
+    while ((c = getopt (argc, argv, "t:Rw:i:o:pl:r:s:T:")) != -1)
+        switch (c) {
+          case 't': seconds = atof (optarg); break;
+          case 'R': realtime = 1; break;
+          case 'w': world = optarg; break;
+          case 'i': in = optarg; break;
+          case 'o': out = optarg; break;
+          case 'p': pty = 1; break;
+          case 'l': l = atof (optarg); break;
+          case 'r': r = atof (optarg); break;
+          case 's': srand ((unsigned) atoi (optarg)); break;
+          case 'T': world_set_trace (optarg); break;
+          default: usage (argv [0]);
+        }
+    if (optind != argc)
+        usage (argv [0]);
+
+    world_load (world);
+    world_set_gain (l / 100, r / 100);
+    host_uart_open (in, out, pty);
+    host_set_limit (seconds, realtime);
+
+    /* The init tasks (constructors) have already run */
+    enable_ints ();
+
+    for (tasks_count = 0; host_tasks [tasks_count] != 0; tasks_count ++)
+        ;
+    tasks = calloc (tasks_count, sizeof (host_task_t));
+    for (current = 0; current < tasks_count; current ++) {
+        t = & tasks [current];
+        getcontext (&t->start);
+        t->start.uc_stack.ss_sp = malloc (host_stack_size);
+        t->start.uc_stack.ss_size = host_stack_size;
+        t->start.uc_link = 0;
+        makecontext (&t->start, host_task_entry, 0);
+    }
+
+    for (current = 0;; current = (current + 1) % tasks_count) {
+        host_cpu = host_cpu_sched;
+        host_advance (host_switch_cycles);
+        host_cpu = host_cpu_task;
+        t = & tasks [current];
+        if (_setjmp (scheduler) != 0)
+            continue;
+        if (! t->started) {
+            t->started = 1;
+            setcontext (&t->start);
+        }
+        _longjmp (t->resume, 1);
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         SynthOS primitives for the host build
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * This file is included ahead of every firmware source when building
+ * for the host. It plays the part of the code SynthOS generates for
+ * the target: loop tasks run as coroutines (see synthos.c), call
+ * tasks run inline in the context of the caller and SynthOS_wait
+ * gives control back to the scheduler until its condition holds.
+ *
+ * The call task prototypes below have to follow project.sop.
+ */
+#ifndef HOST_SYNTHOS_H
+#define HOST_SYNTHOS_H
+
+void host_yield (void);
+
+extern unsigned long host_wait_evals;
+
+#define SynthOS_wait(cond)                                              \
+    do {                                                                \
+        while (host_wait_evals ++, ! (cond))                            \
+            host_yield ();                                              \
+    } while (0)
+
+#define SynthOS_sleep() host_yield ()
+
+#define SynthOS_call(call) (call)
+
+/* Call tasks */
+void drive_pan (unsigned duration);
+void print (long fmt, long a1, long a2, long a3);
+unsigned ultrasonic_measure (void);
+unsigned ultrasonic_wait (void);
+
+#endif
@@ -0,0 +1,42 @@
+#
+# Project:       Arduino (DFRobot rover v2) robot
+# File:          host/tasks.awk
+# Author:        agent
+# Date:          10-17-2026
+#
+# Purpose:       Generates the loop task table of the host build
+#                from the SynthOS project file.
+#
+# Copyright (c) 2014 Zeidman Technologies, Inc.
+# 15565 Swiss Creek Lane, Cupertino California, 95014 
+# All Rights Reserved
+#
+# Zeidman Technologies gives an unlimited, nonexclusive license to
+# use this code  as long as this header comment section is kept
+# intact in all distributions and all future versions of this file
+# and the routines within it.
+#
+
+/^\[/ { section = $0; entry = "" }
+
+section == "[task]" && /^entry *=/ { sub (/^entry *= */, ""); entry = $0 }
+
+section == "[task]" && /^type *= *loop/ { tasks [count ++] = entry }
+
+END {
+    print "/* Generated from project.sop by host/tasks.awk */"
+    for (i = 0; i < count; i ++)
+        print "void " tasks [i] " (void);"
+    print ""
+    print "void (* const host_tasks []) (void) = {"
+    for (i = 0; i < count; i ++)
+        print "    " tasks [i] ","
+    print "    0"
+    print "};"
+    print ""
+    print "const char * const host_task_names [] = {"
+    for (i = 0; i < count; i ++)
+        print "    \"" tasks [i] "\","
+    print "    0"
+    print "};"
+}
@@ -0,0 +1,120 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Remote control from the command line
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Sends the commands given on the command line one after another
+ * and prints the replies:
+ *
+ *     teleop /dev/pts/3 range pan 1200 forward wait 2000 stop auto
+ *
+ * "wait ms" only pauses. With -n count the whole list is run count
+ * times; the latencies of the commands that move something are
+ * summed up at the end.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cmdlink.h"
+
+static const char * const names [] = {
+    "", "stop", "forward", "backward", "left", "right", "pan", "range", "auto", "telemetry"
+};
+
+#define names_count (sizeof (names) / sizeof (names [0]))
+
+static void usage (const char * name) {
+    fprintf (stderr, "usage: %s [-n count] port command [argument]...\n"
+             "  commands: stop forward backward left right pan us range auto telemetry ms wait ms\n", name);
+    exit (1);
+}
+
+int main (int argc, char ** argv) {
+    unsigned count = 1, round, sent = 0, late = 0, code, max = 0;
+    double total = 0;
+    cmdlink_reply_t reply;
+    cmdlink_t link;
+    struct timespec pause;
+    int i, arg;
+
+    if (argc > 2 && strcmp (argv [1], "-n") == 0) {
+        count = atoi (argv [2]);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 3)
+        usage (argv [0]);
+    if (cmdlink_open (&link, argv [1]) < 0) {
+        perror (argv [1]);
+        return 1;
+    }
+
+    for (round = 0; round < count; round ++)
+        for (i = 2; i < argc; i ++) {
+            if (strcmp (argv [i], "wait") == 0 && i + 1 < argc) {
+                arg = atoi (argv [++ i]);
+                pause.tv_sec = arg / 1000;
+                pause.tv_nsec = arg % 1000 * 1000000L;
+                nanosleep (&pause, 0);
+                continue;
+            }
+            for (code = 1; code < names_count && strcmp (argv [i], names [code]) != 0; code ++)
+                ;
+            if (code == names_count)
+                usage (argv [0]);
+            arg = -1;
+            if (code == command_pan || code == command_telemetry) {
+                if (i + 1 >= argc)
+                    usage (argv [0]);
+                arg = atoi (argv [++ i]);
+            }
+            if (cmdlink_send (&link, code, arg, &reply) < 0) {
+                fprintf (stderr, "%s: %s\n", names [code], strerror (errno));
+                return 1;
+            }
+            printf ("%s: %s", names [code], reply.status == command_ok ? "ok" : "bad");
+            if (reply.has_value)
+                printf (", %u", reply.value);
+            if (reply.latency == command_latency_unknown)
+                printf (", latency unknown");
+            else {
+                printf (", latency %u us", reply.latency);
+                /* A range request takes as long as the measurement */
+                if (code != command_range) {
+                    total += reply.latency;
+                    sent ++;
+                    if (reply.latency > max)
+                        max = reply.latency;
+                    if (reply.latency >= 10000)
+                        late ++;
+                }
+            }
+            printf (", round trip %.1f ms\n", reply.round_trip * 1e3);
+        }
+
+    if (sent != 0)
+        printf ("latency: average %.0f us, max %u us, %u of %u at 10 ms or more, %u retries\n",
+                total / sent, max, late, sent, link.retries);
+    cmdlink_close (&link);
+    return 0;
+}
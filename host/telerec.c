@@ -0,0 +1,199 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Telemetry recorder
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Takes the telemetry frames (see telemetry.h) out of what the
+ * firmware sends, writes them to a CSV file and prints loop timing
+ * statistics at the end (end of input or ^C):
+ *
+ *     telerec -o run.csv /dev/ttyACM0
+ *     telerec -o run.csv uart.bin
+ *
+ * The rest of the stream (the print output, command replies) is
+ * skipped.
+ */
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../command.h"
+#include "../telemetry.h"
+
+/* Running statistics */
+typedef struct {
+    unsigned long n;
+    double sum, sum2, min, max;
+} stat_t;
+
+static volatile sig_atomic_t stop;
+
+static void on_signal (int sig) {
+    (void) sig;
+    stop = 1;
+}
+
+static void stat_add (stat_t * s, double v) {
+    if (s->n == 0 || v < s->min)
+        s->min = v;
+    if (s->n == 0 || v > s->max)
+        s->max = v;
+    s->n ++;
+    s->sum += v;
+    s->sum2 += v * v;
+}
+
+static void stat_print (const char * name, const stat_t * s, const char * unit) {
+    double mean;
+
+    if (s->n == 0) {
+        fprintf (stderr, "telerec: %-22s no data\n", name);
+        return;
+    }
+    mean = s->sum / s->n;
+    fprintf (stderr, "telerec: %-22s mean %9.3f, sd %8.3f, min %9.3f, max %9.3f %s (%lu)\n",
+             name, mean, sqrt (fmax (s->sum2 / s->n - mean * mean, 0)), s->min, s->max, unit, s->n);
+}
+
+static unsigned get16 (const uint8_t * data, unsigned offset) {
+    return data [offset] | data [offset + 1] << 8;
+}
+
+int main (int argc, char ** argv) {
+    uint8_t frame [telemetry_size + 2], in [256];
+    unsigned length = 0, i, n, sequence = 0;
+    int fd, escape = 0, overflow = 0, first = 1, c;
+    unsigned long lost = 0;
+    uint32_t time, last_time = 0;
+    stat_t interval = { 0 }, middle [2] = { { 0 } }, torque [2] = { { 0 } }, cost = { 0 };
+    const char * out_name = 0;
+    struct termios t;
+    FILE * out = stdout;
+    uint16_t crc;
+    ssize_t got;
+
+    while ((c = getopt (argc, argv, "o:")) != -1)
+        if (c == 'o')
+            out_name = optarg;
+        else {
+            fprintf (stderr, "usage: %s [-o file.csv] input\n", argv [0]);
+            return 1;
+        }
+    if (optind != argc - 1) {
+        fprintf (stderr, "usage: %s [-o file.csv] input\n", argv [0]);
+        return 1;
+    }
+    fd = open (argv [optind], O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror (argv [optind]);
+        return 1;
+    }
+    if (isatty (fd) && tcgetattr (fd, &t) == 0) {
+        cfmakeraw (&t);
+        cfsetispeed (&t, B115200);
+        tcsetattr (fd, TCSANOW, &t);
+    }
+    if (out_name != 0 && (out = fopen (out_name, "w")) == 0) {
+        perror (out_name);
+        return 1;
+    }
+    signal (SIGINT, on_signal);
+    fprintf (out, "sequence,time_us,action,flags,left_count,right_count,left_torque,right_torque,"
+             "left_middle_ms,right_middle_ms,pan_us,range_cm,cost_us\n");
+
+    while (! stop && (got = read (fd, in, sizeof (in))) > 0)
+        for (i = 0; i < (unsigned) got; i ++) {
+            c = in [i];
+            if (c != command_slip_end) {
+                if (c == command_slip_esc) {
+                    escape = 1;
+                    continue;
+                }
+                if (escape) {
+                    escape = 0;
+                    if (c == command_slip_esc_end)
+                        c = command_slip_end;
+                    else if (c == command_slip_esc_esc)
+                        c = command_slip_esc;
+                }
+                if (length < sizeof (frame))
+                    frame [length ++] = c;
+                else
+                    overflow = 1;
+                continue;
+            }
+
+            /* End of a frame, is it a sample? */
+            n = length;
+            length = 0;
+            escape = 0;
+            if (overflow || n != sizeof (frame) || frame [telemetry_type] != telemetry_frame_type) {
+                overflow = 0;
+                continue;
+            }
+            crc = 0xFFFF;
+            for (n = 0; n < sizeof (frame); n ++)
+                crc = command_crc (crc, frame [n]);
+            if (crc != 0)
+                continue;
+
+            time = get16 (frame, telemetry_time) | (uint32_t) get16 (frame, telemetry_time + 2) << 16;
+            if (! first) {
+                lost += (uint8_t) (frame [telemetry_sequence] - sequence - 1);
+                /* Only the neighbours tell the loop timing */
+                if ((uint8_t) (frame [telemetry_sequence] - sequence) == 1)
+                    stat_add (&interval, (uint32_t) (time - last_time) * 1e-3);
+            }
+            first = 0;
+            sequence = frame [telemetry_sequence];
+            last_time = time;
+            for (n = 0; n < 2; n ++) {
+                if (get16 (frame, telemetry_left_middle + 2 * n) != 0)
+                    stat_add (&middle [n], get16 (frame, telemetry_left_middle + 2 * n));
+                if (frame [telemetry_left_torque + n] != 0)
+                    stat_add (&torque [n], frame [telemetry_left_torque + n]);
+            }
+            if (get16 (frame, telemetry_cost) != 0)
+                stat_add (&cost, get16 (frame, telemetry_cost) * 0.5);
+            fprintf (out, "%u,%lu,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.1f\n",
+                     frame [telemetry_sequence], (unsigned long) time, frame [telemetry_action],
+                     frame [telemetry_flags], get16 (frame, telemetry_left_count),
+                     get16 (frame, telemetry_right_count), frame [telemetry_left_torque],
+                     frame [telemetry_right_torque], get16 (frame, telemetry_left_middle),
+                     get16 (frame, telemetry_right_middle), get16 (frame, telemetry_pan),
+                     get16 (frame, telemetry_range), get16 (frame, telemetry_cost) * 0.5);
+        }
+
+    if (out != stdout)
+        fclose (out);
+    fprintf (stderr, "telerec: %lu samples lost\n", lost);
+    stat_print ("sample interval", &interval, "ms");
+    stat_print ("left sector period", &middle [0], "ms");
+    stat_print ("right sector period", &middle [1], "ms");
+    stat_print ("left torque", &torque [0], "PWM");
+    stat_print ("right torque", &torque [1], "PWM");
+    stat_print ("sample cost", &cost, "us");
+    return 0;
+}
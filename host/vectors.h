@@ -0,0 +1,32 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Interrupt vectors known to the simulator
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ */
+HOST_VECTOR (PCINT2_vect)
+HOST_VECTOR (TIMER2_COMPA_vect)
+HOST_VECTOR (TIMER2_COMPB_vect)
+HOST_VECTOR (TIMER2_OVF_vect)
+HOST_VECTOR (TIMER1_CAPT_vect)
+HOST_VECTOR (TIMER1_COMPA_vect)
+HOST_VECTOR (TIMER1_COMPB_vect)
+HOST_VECTOR (TIMER1_OVF_vect)
+HOST_VECTOR (USART_RX_vect)
+HOST_VECTOR (USART_UDRE_vect)
+HOST_VECTOR (USART_TX_vect)
+HOST_VECTOR (ADC_vect)
@@ -0,0 +1,426 @@
+/**
+ * @addtogroup    Host
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Rover and surroundings model
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * --------------------------------------------------------
+ * Part              | Model
+ * ------------------|-------------------------------------
+ * Motors            | first order lag toward a speed set by PWM duty
+ *                   | above a dead zone (larger when the tracks oppose)
+ * Encoders          | 16 states per turn, openings 0.8 and bridges 1.2
+ *                   | of a state, analog levels around 840
+ * Servos            | move toward the last pulse width at a fixed slew
+ *                   | rate for one frame (20 ms) after every pulse
+ * Ultrasonic sensor | single pin sensor: 750 us hold off after the
+ *                   | trigger, then a high pulse as long as the round
+ *                   | trip (115 us - 18.5 ms), 5 ray cone on the pan head
+ * IR eyes           | fixed on the body, ambient light plus the
+ *                   | reflection of the IR leds from walls within 40 cm
+ *
+ * The surroundings are line segments (walls) in centimeters. World
+ * files contain lines "wall x1 y1 x2 y2", "box x y width height" and
+ * "rover x y heading" (heading in degrees, counterclockwise from the
+ * x axis); '#' starts a comment. The default world is a 400 x 300 box
+ * with the rover in the middle.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+
+#define world_pi                3.14159265358979323846
+#define world_step_cycles       (F_CPU / 1000)        /* physics step: 1 ms */
+#define world_walls_max         256
+#define world_rover_radius      9.0                   /* cm */
+#define world_track             13.0                  /* cm */
+#define world_state_length      (2 * world_pi * 1.7 / 16) /* cm per encoder state */
+#define world_dead_straight     40                    /* PWM counts */
+#define world_dead_turn         70                    /* PWM counts */
+#define world_rate_per_count    (1 / 14.0)            /* states/s per PWM count */
+#define world_motor_lag         0.08                  /* s */
+#define world_servo_slew        2667.0                /* us of pulse width per s */
+#define world_servo_frame       0.02                  /* s */
+#define world_us_holdoff        750e-6                /* s */
+#define world_us_min            115e-6                /* s */
+#define world_us_max            18.5e-3               /* s */
+#define world_us_cone           (10 * world_pi / 180)
+#define world_sound             34300.0               /* cm/s */
+#define world_ir_range          40.0                  /* cm */
+
+typedef struct {
+    double x1, y1, x2, y2;
+} wall_t;
+
+typedef struct {
+    double gain, rate, phase;
+    long states;
+} wheel_t;
+
+typedef struct {
+    double position, target, until;
+    uint64_t rise;
+    int level;
+    unsigned long pulses;
+} servo_t;
+
+static wall_t walls [world_walls_max];
+static unsigned walls_count;
+static double rover_x = 200, rover_y = 150, rover_heading;
+static double travelled, turned;
+static unsigned long collisions;
+static wheel_t left = { 1 }, right = { 1 };
+static servo_t pan = { 1200, 1200 }, tilt = { 1200, 1200 };
+static uint64_t world_last;
+static FILE * trace;
+
+/* Ultrasonic sensor */
+static int us_output_level, us_level;
+static uint64_t us_trigger, us_rise, us_fall;
+static unsigned long us_pings, us_timeouts;
+
+/* Measurements the firmware made, if it counts them */
+extern unsigned long ultrasonic_count __attribute__ ((weak));
+
+static double now_s (void) {
+    return (double) host_now / F_CPU;
+}
+
+static double noise (double radius) {
+    return ((double) rand () / RAND_MAX * 2 - 1) * radius;
+}
+
+static void add_wall (double x1, double y1, double x2, double y2) {
+    if (walls_count == world_walls_max)
+        return;
+    walls [walls_count].x1 = x1;
+    walls [walls_count].y1 = y1;
+    walls [walls_count].x2 = x2;
+    walls [walls_count].y2 = y2;
+    walls_count ++;
+}
+
+static void add_box (double x, double y, double w, double h) {
+    add_wall (x, y, x + w, y);
+    add_wall (x + w, y, x + w, y + h);
+    add_wall (x + w, y + h, x, y + h);
+    add_wall (x, y + h, x, y);
+}
+
+/**
+ * @brief  Loads the surroundings
+ * @param  path  world file (0 - default world)
+ */
+void world_load (const char * path) {
+    char line [256], kind [16];
+    double a, b, c, d;
+    FILE * f;
+    int n;
+
+    if (path == 0) {
+        add_box (0, 0, 400, 300);
+        return;
+    }
+    f = fopen (path, "r");
+    if (f == 0) {
+        perror (path);
+        exit (1);
+    }
+    while (fgets (line, sizeof (line), f) != 0) {
+        if (strchr (line, '#') != 0)
+            * strchr (line, '#') = 0;
+        n = sscanf (line, "%15s %lf %lf %lf %lf", kind, &a, &b, &c, &d);
+        if (n <= 0)
+            continue;
+        if (strcmp (kind, "wall") == 0 && n == 5)
+            add_wall (a, b, c, d);
+        else if (strcmp (kind, "box") == 0 && n == 5)
+            add_box (a, b, c, d);
+        else if (strcmp (kind, "rover") == 0 && n == 4) {
+            rover_x = a;
+            rover_y = b;
+            rover_heading = c * world_pi / 180;
+        } else {
+            fprintf (stderr, "%s: bad line: %s", path, line);
+            exit (1);
+        }
+    }
+    fclose (f);
+}
+
+/**
+ * @brief  Sets motor efficiency
+ * @param  l  left motor gain (1 - nominal)
+ * @param  r  right motor gain (1 - nominal)
+ */
+void world_set_gain (double l, double r) {
+    left.gain = l;
+    right.gain = r;
+}
+
+/**
+ * @brief  Starts writing the rover pose every 100 ms
+ * @param  path  trace file
+ */
+void world_set_trace (const char * path) {
+    trace = fopen (path, "w");
+    if (trace == 0) {
+        perror (path);
+        exit (1);
+    }
+    fprintf (trace, "# time x y heading\n");
+}
+
+/**
+ * @brief  Casts a ray
+ * @return  distance to the nearest wall in cm (HUGE_VAL - nothing)
+ */
+static double ray (double x, double y, double angle) {
+    double dx = cos (angle), dy = sin (angle), best = HUGE_VAL;
+    double ex, ey, den, t, u;
+    unsigned i;
+
+    for (i = 0; i < walls_count; i ++) {
+        ex = walls [i].x2 - walls [i].x1;
+        ey = walls [i].y2 - walls [i].y1;
+        den = dx * ey - dy * ex;
+        if (fabs (den) < 1e-12)
+            continue;
+        t = ((walls [i].x1 - x) * ey - (walls [i].y1 - y) * ex) / den;
+        u = ((walls [i].x1 - x) * dy - (walls [i].y1 - y) * dx) / den;
+        if (t > 0 && u >= 0 && u <= 1 && t < best)
+            best = t;
+    }
+    return best;
+}
+
+/** @brief Distance from the rover center to the nearest wall */
+static double clearance (double x, double y) {
+    double best = HUGE_VAL, ex, ey, l, t, px, py, d;
+    unsigned i;
+
+    for (i = 0; i < walls_count; i ++) {
+        ex = walls [i].x2 - walls [i].x1;
+        ey = walls [i].y2 - walls [i].y1;
+        l = ex * ex + ey * ey;
+        t = l > 0 ? ((x - walls [i].x1) * ex + (y - walls [i].y1) * ey) / l : 0;
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        px = walls [i].x1 + t * ex - x;
+        py = walls [i].y1 + t * ey - y;
+        d = sqrt (px * px + py * py);
+        if (d < best)
+            best = d;
+    }
+    return best;
+}
+
+static double pan_angle (void) {
+    /* 1200 us is straight ahead, 600 us is 90 degrees to the right */
+    return (pan.position - 1200) / 600 * world_pi / 2;
+}
+
+static void wheel_step (wheel_t * w, int enabled, int backward, unsigned duty, unsigned dead, double dt) {
+    double target = 0;
+
+    if (enabled && duty > dead)
+        target = (duty - dead) * world_rate_per_count * w->gain * (backward ? -1 : 1);
+    w->rate += (target - w->rate) * dt / world_motor_lag;
+    w->phase += w->rate * dt;
+    w->states = (long) floor (w->phase);
+}
+
+static void servo_step (servo_t * s, int level, double dt) {
+    double width, step;
+
+    if (level && ! s->level)
+        s->rise = host_now;
+    if (! level && s->level) {
+        width = (double) (host_now - s->rise) / host_cycles_per_us;
+        if (width >= 500 && width <= 2500) {
+            s->target = width;
+            s->until = now_s () + world_servo_frame;
+            s->pulses ++;
+        }
+    }
+    s->level = level;
+    if (dt == 0 || now_s () > s->until)
+        return;
+    step = world_servo_slew * dt;
+    if (fabs (s->target - s->position) <= step)
+        s->position = s->target;
+    else
+        s->position += s->target > s->position ? step : - step;
+}
+
+static void rover_step (double dt) {
+    int l_on = (DDRD & _BV (DDD5)) && (TCCR0A & _BV (COM0B1)) && (TCCR0B & 7);
+    int r_on = (DDRD & _BV (DDD6)) && (TCCR0A & _BV (COM0A1)) && (TCCR0B & 7);
+    int l_back = (PORTD & _BV (PORTD7)) != 0, r_back = (PORTB & _BV (PORTB0)) != 0;
+    unsigned dead = l_on && r_on && l_back != r_back ? world_dead_turn : world_dead_straight;
+    long l_states = left.states, r_states = right.states;
+    double vl, vr, v, x, y;
+
+    wheel_step (&left, l_on, l_back, OCR0B, dead, dt);
+    wheel_step (&right, r_on, r_back, OCR0A, dead, dt);
+    vl = left.rate * world_state_length;
+    vr = right.rate * world_state_length;
+    v = (vl + vr) / 2;
+    x = rover_x + v * dt * cos (rover_heading);
+    y = rover_y + v * dt * sin (rover_heading);
+    if (clearance (x, y) < world_rover_radius && clearance (x, y) < clearance (rover_x, rover_y)) {
+        /* Stuck against a wall: the tracks stop */
+        if (fabs (v) > 0.1)
+            collisions ++;
+        left.rate = right.rate = 0;
+        left.phase = left.states = l_states;
+        right.phase = right.states = r_states;
+        return;
+    }
+    travelled += fabs (v * dt);
+    turned += fabs ((vr - vl) / world_track * dt);
+    rover_x = x;
+    rover_y = y;
+    rover_heading += (vr - vl) / world_track * dt;
+}
+
+static void ultrasonic_step (void) {
+    int level = (DDRD & _BV (DDD4)) && (PORTD & _BV (PORTD4));
+    double d, a, round_trip;
+    int i;
+
+    if (us_output_level && ! level && (DDRD & _BV (DDD4)) && us_rise == 0) {
+        /* End of the trigger pulse */
+        us_trigger = host_now;
+        us_rise = host_now + (uint64_t) (world_us_holdoff * F_CPU);
+    }
+    us_output_level = level;
+    if (us_rise != 0 && us_fall == 0 && host_now >= us_rise) {
+        d = HUGE_VAL;
+        for (i = -2; i <= 2; i ++) {
+            a = ray (rover_x, rover_y, rover_heading + pan_angle () + i * world_us_cone / 2);
+            if (a < d)
+                d = a;
+        }
+        round_trip = 2 * d / world_sound;
+        if (round_trip < world_us_min)
+            round_trip = world_us_min;
+        if (round_trip > world_us_max) {
+            round_trip = world_us_max;
+            us_timeouts ++;
+        }
+        us_pings ++;
+        us_level = 1;
+        us_fall = host_now + (uint64_t) (round_trip * F_CPU);
+    }
+    if (us_fall != 0 && host_now >= us_fall) {
+        us_level = 0;
+        us_rise = us_fall = 0;
+    }
+}
+
+/**
+ * @brief  Moves the world to the current time
+ */
+void world_step (void) {
+    double dt;
+
+    servo_step (&pan, (PINB & _BV (PORTB2)) != 0, 0);
+    servo_step (&tilt, (PINB & _BV (PORTB1)) != 0, 0);
+    ultrasonic_step ();
+    if (host_now - world_last < world_step_cycles)
+        return;
+    dt = (double) (host_now - world_last) / F_CPU;
+    world_last = host_now;
+    servo_step (&pan, pan.level, dt);
+    servo_step (&tilt, tilt.level, dt);
+    rover_step (dt);
+    if (trace != 0 && host_now % (F_CPU / 10) < world_step_cycles)
+        fprintf (trace, "%.3f %.2f %.2f %.2f\n", now_s (), rover_x, rover_y,
+                 rover_heading * 180 / world_pi);
+}
+
+/**
+ * @brief  Reports what the outside world drives on port D
+ * @return  pin levels
+ */
+uint8_t world_pind (void) {
+    return us_level ? _BV (PIND4) : 0;
+}
+
+static uint16_t encoder (const wheel_t * w) {
+    double pair = w->phase / 2;
+
+    pair -= floor (pair);
+    return (uint16_t) ((pair < 0.4 ? 780 : 900) + noise (3));
+}
+
+static uint16_t eye (double angle) {
+    double d = ray (rover_x, rover_y, rover_heading + angle), v = 60;
+
+    if ((DDRB & _BV (DDB4)) && (PORTB & _BV (PORTB4)) && d < world_ir_range)
+        v += d < 3 ? 900 : 40000 / (d * d) > 900 ? 900 : 40000 / (d * d);
+    return (uint16_t) (v + noise (4));
+}
+
+/**
+ * @brief  Samples an analog input
+ * @param  channel  multiplexer channel
+ * @return  10 bit value
+ */
+uint16_t world_adc (uint8_t channel) {
+    int leds = (DDRB & _BV (DDB4)) && (PORTB & _BV (PORTB4));
+
+    switch (channel) {
+      case 0:
+        return encoder (&left);
+      case 1:
+        return encoder (&right);
+      case 2:
+        return eye (world_pi / 5);
+      case 3:
+        return eye (0);
+      case 4:
+        return eye (- world_pi / 5);
+      case 5:
+        /* Looks at the floor */
+        return (uint16_t) (60 + (leds ? 250 : 0) + noise (4));
+      case 8:
+        /* About 25 C */
+        return (uint16_t) (352 + noise (2));
+      default:
+        return 0;
+    }
+}
+
+/**
+ * @brief  Prints the rover report
+ * @param  f  output stream
+ */
+void world_report (FILE * f) {
+    fprintf (f, "host: rover: at %.1f %.1f heading %.1f, travelled %.1f cm, turned %.0f deg, collisions %lu\n",
+             rover_x, rover_y, rover_heading * 180 / world_pi, travelled, turned * 180 / world_pi, collisions);
+    fprintf (f, "host: encoders: left %ld, right %ld states\n", labs (left.states), labs (right.states));
+    fprintf (f, "host: pan: %lu pulses, ultrasonic: %lu pings, %lu timeouts\n", pan.pulses, us_pings, us_timeouts);
+    /* Every measurement needs a ping of its own */
+    if (& ultrasonic_count != 0 && ultrasonic_count > us_pings)
+        fprintf (f, "host: error: %lu ultrasonic measurements from %lu pings\n", ultrasonic_count, us_pings);
+    if (trace != 0)
+        fflush (trace);
+}
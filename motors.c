@@ -23,11 +23,21 @@
  * All the routines beside motors_stop reset the left and 
  * right counters.
  */
+#define PRINT_MODULE print_module_motors
+
+#include "events.h"
+#include "fixed.h"
 #include "timer.h"
+#include "hardware.h"
 #include "print.h"
 #include "motors.h"
 #include "util.h"
 
+/* Sector period the speed controller keeps, in ms (the cruise speed) */
+#ifndef MOTORS_TIME_TARGET
+#define MOTORS_TIME_TARGET 280
+#endif
+
 /* 
  * We need to apply a higher torque when turn
  * The speed of the robot greatly depends on the
@@ -35,19 +45,55 @@
  * these xxx_speed_yyy values.
  */
 typedef enum {
-    encoders_middle            = 840, /* Analog readout middle value */
-    margin                     =  10, /* Uncertainty radius around the middle encoder value */
     low_speed_normal           =  80, /* in a part of 255 */
     high_speed_normal          = 100, /* in a part of 255 */
     low_speed_turn             = 120, /* in a part of 255 */
     high_speed_turn            = 140, /* in a part of 255 */
-    time_top                   =  34, /* in ticks */
-    time_bottom                =  22, /* in ticks */
-    sector_maximum_delay       = 300, /* in ticks */
-    acceleration_count         =   2, /* in wheel sectors */
-    initial_acceleration_count =   8, /* in wheel sectors */
+    time_target                = MOTORS_TIME_TARGET, /* in ms */
+    time_tolerance             =   6, /* in ms */
+    sector_maximum_delay       = 3000, /* in ms */
 } motors_values_type;
 
+/*
+ * Speed controller gains in PWM counts per ms of the sector period
+ * error, with 8 fraction bits. The integral gain applies once per
+ * sector.
+ */
+#ifndef MOTORS_KP
+#define MOTORS_KP 12
+#endif
+#ifndef MOTORS_KI
+#define MOTORS_KI 12
+#endif
+#ifndef MOTORS_KD
+#define MOTORS_KD 0
+#endif
+
+/*
+ * Cross-coupling gain: ms of period error per ms one wheel is ahead of
+ * the other, with 8 fraction bits
+ */
+#ifndef MOTORS_KS
+#define MOTORS_KS 8
+#endif
+
+/* The wheels are slipping when their sector counts differ by more */
+#ifndef MOTORS_SLIP_COUNT
+#define MOTORS_SLIP_COUNT 4
+#endif
+
+/**
+ * @brief Speed controller state
+ *
+ * The integral term carries the operating point, so it starts
+ * at the initial torque.
+ */
+typedef struct {
+    long integral;      /* in PWM counts, 8 fraction bits */
+    int error;          /* previous error, in ms */
+    uint8_t low, high;  /* output range, in PWM counts */
+} motors_pid_type;
+
 /**
  * @brief  Last request made to the module via motors_xxx
  * 
@@ -58,6 +104,29 @@ volatile motors_action_t motors_action;
 /** @brief Wheel sector counters */
 volatile unsigned motors_left_count, motors_right_count;
 
+/** @brief Set when the wheel sector counts diverge, see MOTORS_SLIP_COUNT */
+volatile uint8_t motors_slip;
+
+/**
+ * @brief Wheel progress the other motor task keeps up with
+ *
+ * Openings and bridges are not equal (see normalize), so the distance
+ * is in fifths of an average sector: 4 for the sectors ending with
+ * level 1 and 6 for the others.
+ */
+typedef struct {
+    uint32_t time;      /* when the wheel passed its last sector, see timer_us */
+    unsigned distance;  /* in 1/5 of a sector */
+    unsigned middle;    /* sector period in ms, 0 - not known yet */
+    int8_t level;       /* level the last sector ended with */
+    uint8_t saturated;  /* the torque is at its highest */
+    uint8_t torque;     /* in PWM counts, 0 - the motor is off */
+    motors_action_t action;  /* what the task has put on the motor */
+    uint32_t action_time;    /* and when, see timer_us */
+} motors_wheel_type;
+
+static motors_wheel_type motors_left_wheel, motors_right_wheel;
+
 /** @brief Module initialization routine */
 static void motors_init (void) __attribute__ ((constructor));
 static void motors_init (void) {
@@ -65,33 +134,81 @@ static void motors_init (void) {
     motors_left_count = motors_right_count = 0;
 }
 
+/** @brief Starts counting the sectors of a new movement */
+static void motors_reset (void) {
+    motors_left_count = motors_right_count = 0;
+    motors_left_wheel.distance = motors_right_wheel.distance = 0;
+    motors_left_wheel.middle = motors_right_wheel.middle = 0;
+    motors_left_wheel.saturated = motors_right_wheel.saturated = 0;
+    motors_slip = 0;
+}
+
+/**
+ * @brief  Reports the state of the speed controllers
+ * @param  torque  gets the torques of the left and the right wheel in PWM counts
+ * @param  middle  gets their sector periods in ms, 0 - not known
+ */
+void motors_wheels (uint8_t * torque, unsigned * middle) {
+    torque [0] = motors_left_wheel.torque;
+    torque [1] = motors_right_wheel.torque;
+    middle [0] = motors_left_wheel.middle;
+    middle [1] = motors_right_wheel.middle;
+}
+
+/**
+ * @brief  Tells whether both motor tasks have put motors_action on the motors
+ * @param  time  gets the timer_us of the later one, if they have
+ * @return  not 0 if they have
+ */
+uint8_t motors_applied (uint32_t * time) {
+    motors_action_t action = motors_action;
+
+    if (motors_left_wheel.action != action || motors_right_wheel.action != action)
+        return 0;
+    *time = motors_left_wheel.action_time;
+    if ((int32_t) (motors_right_wheel.action_time - *time) > 0)
+        *time = motors_right_wheel.action_time;
+    return 1;
+}
+
+/** @brief Wakes both motor tasks up, "motors_action" has changed */
+static void motors_signal (void) {
+    event_signal (event_motors_left);
+    event_signal (event_motors_right);
+}
+
 /** @brief Stops the motors */
 void motors_stop (void) {
     motors_action = motors_action_stop;
+    motors_signal ();
 }
 
 /** @brief Starts left turn */
 void motors_left (void) {
     motors_action = motors_action_left;
-    motors_left_count = motors_right_count = 0;
+    motors_signal ();
+    motors_reset ();
 }
 
 /** @brief Starts right turn */
 void motors_right (void) {
     motors_action = motors_action_right;
-    motors_left_count = motors_right_count = 0;
+    motors_signal ();
+    motors_reset ();
 }
 
 /** @brief Starts forward motion */
 void motors_forward (void) {
     motors_action = motors_action_forward;
-    motors_left_count = motors_right_count = 0;
+    motors_signal ();
+    motors_reset ();
 }
 
 /** @brief Starts backward motion */
 void motors_backward (void) {
-    motors_action = motors_action_forward;
-    motors_left_count = motors_right_count = 0;
+    motors_action = motors_action_backward;
+    motors_signal ();
+    motors_reset ();
 }
 
 /**
@@ -119,19 +236,6 @@ static unsigned get_middle (unsigned a [3], unsigned p) {
     return v2; /* v3 < v2 < v1 */
 }
 
-/**
- * @brief Analyzes an encoder value
- * @param  v  encoder value
- * @return  1 - low, 0 - not sure, 1 - high.
- */
-static int qualify (unsigned v) {
-    if (v <= encoders_middle - margin)
-        return -1;
-    if (v >= encoders_middle + margin)
-        return 1;
-    return  0;
-}
-
 /**
  * @brief Interval normalization
  *
@@ -144,14 +248,82 @@ static int qualify (unsigned v) {
  * @return  normalized value
  */
 static unsigned normalize (unsigned t, int q) {
-    return q > 0 ? t * 5 / 4 : t * 5 / 6;
+    return fixed_scale (t, q > 0 ? fixed_q (5, 4, 8) : fixed_q (5, 6, 8), 8);
+}
+
+/**
+ * @brief Starts the speed controller
+ * @param  pid  controller state
+ * @param  low  initial and lowest torque
+ * @param  high  highest torque
+ */
+static void pid_start (motors_pid_type * pid, uint8_t low, uint8_t high) {
+    pid->integral = (long) low << 8;
+    pid->error = 0;
+    pid->low = low;
+    pid->high = high;
+}
+
+/**
+ * @brief Computes the torque for the next sector
+ * @param  pid  controller state
+ * @param  error  sector period minus the target, in ms
+ *         (positive - we move too slow)
+ * @return  torque
+ */
+static uint8_t pid_update (motors_pid_type * pid, int error) {
+    long low = (long) pid->low << 8, high = (long) pid->high << 8, out;
+
+    /* Anti-windup: the integral alone never leaves the output range */
+    pid->integral += (long) MOTORS_KI * error;
+    if (pid->integral < low)
+        pid->integral = low;
+    else if (pid->integral > high)
+        pid->integral = high;
+
+    out = pid->integral + (long) MOTORS_KP * error +
+        (long) MOTORS_KD * (error - pid->error);
+    pid->error = error;
+    if (out < low)
+        out = low;
+    else if (out > high)
+        out = high;
+    return (uint8_t) ((out + 128) >> 8);
+}
+
+/**
+ * @brief Cross-coupling term of the speed controller
+ *
+ * The other wheel's distance is extrapolated from its last sector and
+ * its period, so the term does not jump by a whole sector whenever
+ * one of the wheels passes an edge.
+ *
+ * @param  wheel  this wheel, it has just passed a sector
+ * @param  other  the other wheel
+ * @return  period error correction in ms (positive - this wheel is behind)
+ */
+static int motors_sync (const motors_wheel_type * wheel, const motors_wheel_type * other) {
+    uint32_t part;
+    unsigned length;
+    long lead;
+
+    if (other->middle == 0)
+        return 0;
+    /* How far the other wheel went into the sector it is in now */
+    length = other->level > 0 ? 6 : 4;
+    part = (wheel->time - other->time) * 5 / (other->middle * 1000UL);
+    if (part > length)
+        part = length;
+    /* How long (ms) this wheel is ahead of the other */
+    lead = ((long) (int) (wheel->distance - other->distance) - (long) part) * other->middle / 5;
+    return (int) (- lead * MOTORS_KS / 256);
 }
 
 /* Everything below the cut line would be duplicated with "left" <-> "right"
    substitution. */
 /* --- cut --- */
 
-unsigned motors_left_timer;
+timer_type motors_left_timer;
 motors_action_t left_action;
 
 /**
@@ -159,145 +331,119 @@ motors_action_t left_action;
  *
  * Duplicating this function we get two functions:
  * one for the left motor and one for the right. The function controlled by setting
- * "motors_action". After the movement started, it constantly read the encoder value
- * and adjust speed accordingly. Also, it beeps and poweres the robot down when the
- * track gets stuck. To avoid oscillation, we get the middle value of every three
- * consecutive readings and allow some tolerance range. Also, let the robot 
- * accelerate/decelerate before making another decision about the speed.
+ * "motors_action". After the movement started, it takes the sector periods the
+ * encoder front-end measures and adjust speed accordingly. Also, it beeps and
+ * poweres the robot down when the track gets stuck. To avoid oscillation, we get
+ * the middle value of every three consecutive periods and feed it to a PI
+ * controller that drives the period toward time_target.
  */
 void left_motor () {
-    unsigned index, mark, acc_start, acc_count, speed, middle, high_speed, last_clock;
-    int value, new_value;
-    unsigned clocks [3]; /* circular buffer containing last 3 encoder readings
+    unsigned index, count, speed, torque, middle, target, low_speed, high_speed;
+    int error;
+    motors_pid_type pid;
+    uint32_t period;
+    int8_t level;
+    unsigned clocks [3]; /* circular buffer containing last 3 sector periods
                             (addressed by "index") */
 
+    motors_left_timer.event = event_motors_left;
+
  stop_motor:
     left_motor_disable ();
+    motors_left_wheel.torque = 0;
 
  handle:
     left_action = motors_action;
 
     switch (left_action) {
       case motors_action_forward:
-        speed = low_speed_normal;
+        low_speed = low_speed_normal;
         high_speed = high_speed_normal;
         left_motor_forward ();
         break;
       case motors_action_backward:
-        speed = low_speed_normal;
+        low_speed = low_speed_normal;
         high_speed = high_speed_normal;
         left_motor_backward ();
         break;
       case motors_action_left:
-        speed = low_speed_turn;
+        low_speed = low_speed_turn;
         high_speed = high_speed_turn;
         left_motor_backward ();
         break;
       case motors_action_right:
-        speed = low_speed_turn;
+        low_speed = low_speed_turn;
         high_speed = high_speed_turn;
         left_motor_forward ();
         break;
       default:
         ;
         /* This includes motors_action_stop */
-        SynthOS_wait (motors_action != left_action);
+        motors_left_wheel.action = left_action;
+        motors_left_wheel.action_time = timer_us ();
+        event_wait (event_motors_left, motors_action != left_action);
         goto handle;
     }
 
+    speed = low_speed;
     left_motor_set (speed);
+    motors_left_wheel.torque = speed;
+    pid_start (&pid, low_speed, high_speed);
 
     left_motor_enable ();
+    motors_left_wheel.action = left_action;
+    motors_left_wheel.action_time = timer_us ();
 
-    mark = clock;
-    value = qualify (left_encoder ());
+    /* Whatever the encoder did while we were stopped does not count */
+    encoder_flush (encoder_left);
+    index = count = 0;
 
-    /* Waiting for the first value change */
     for (;;) {
-        motors_left_timer = clock;
-        SynthOS_wait (clock != motors_left_timer || motors_action != left_action);
+        /* Wait for the next edge */
+        timer_start (&motors_left_timer, timer_us () + sector_maximum_delay * 1000UL);
+        event_wait (event_motors_left, motors_action != left_action ||
+                    encoder_ready (encoder_left) || motors_left_timer.expired);
         if (motors_action != left_action)
             goto stop_motor;
-        new_value = qualify (left_encoder ());
-        if (new_value != 0 && new_value != value)
-            break;
-        if (clock - mark >= sector_maximum_delay)
-            do_power_down ("motors: left failed 1\n");
-    }
-
-    motors_left_count ++;
-
-    last_clock = clock;
-
-    /* Getting 3 values */
-    for (index = 0; index < 3; index ++) {
-        mark = clock;
-        for (;;) {
-            motors_left_timer = clock;
-            SynthOS_wait (clock != motors_left_timer || motors_action != left_action);
-            if (motors_action != left_action)
-                goto stop_motor;
-            new_value = qualify (left_encoder ());
-            if (new_value != 0 && new_value != value)
-                break;
-            if (clock - mark >= sector_maximum_delay)
-                do_power_down ("motors: left failed 2\n");
-        }
-        clocks [index] = normalize (clock - last_clock, new_value);
-        last_clock = clock;
-        value = new_value;
+        if (! encoder_ready (encoder_left))
+            do_power_down ("motors: left failed\n");
+        period = encoder_period (encoder_left, &level);
         motors_left_count ++;
-    }
+        motors_left_wheel.time = timer_us ();
+        motors_left_wheel.distance += level > 0 ? 4 : 6;
+        motors_left_wheel.level = level;
+        if (period == 0)
+            /* The first edge, no period yet */
+            continue;
+        clocks [index] = normalize (fixed_us_to_ms (period), level);
+        index = (index + 1) % 3;
+        if (count < 3 && ++ count < 3)
+            /* Getting 3 values */
+            continue;
 
-    /* Main loop */
-    index = 0;
-    acc_start = motors_left_count;
-    /* No more adjustments until get this number of readings */
-    acc_count = initial_acceleration_count;
-    for (;;) {
-        if (acc_count != 0 && motors_left_count - acc_start >= acc_count)
-            acc_count = 0;
-        if (acc_count == 0) {
-            middle = get_middle (clocks, index);
-            if (middle > time_top) {
-                /* Try to increase the speed, we move too slow */
-                if (speed < high_speed) {
-                    print2 ("motors: left up: %u %u\n", middle, speed);
-                    speed ++;
-                    left_motor_set (speed);
-                    acc_start = motors_left_count;
-                    /* No more adjustments until get this number of readings */
-                    acc_count = acceleration_count;
-                }
-            } else 
-                if (middle < time_bottom) {
-                    /* Try to decrease the speed, we move too fast */
-                    if (speed > 0) {
-                        print2 ("motors: left down: %u %u\n", middle, speed);
-                        speed --;
-                        left_motor_set (speed);
-                        acc_start = motors_left_count;
-                        /* No more adjustments until get this number of readings */
-                        acc_count = acceleration_count;
-                    }
-                }
+        middle = get_middle (clocks, index);
+        motors_left_wheel.middle = middle;
+        /* Do not run away from the other wheel when it cannot go faster */
+        target = time_target;
+        if (motors_right_wheel.saturated && motors_right_wheel.middle > target)
+            target = motors_right_wheel.middle;
+        error = (int) middle - (int) target;
+        if (error >= - time_tolerance && error <= time_tolerance)
+            /* Close enough, hold the torque */
+            error = 0;
+        /* Keep up with the other wheel */
+        error += motors_sync (&motors_left_wheel, &motors_right_wheel);
+        if (! motors_slip && (int) (motors_left_count - motors_right_count) > MOTORS_SLIP_COUNT) {
+            motors_slip = 1;
+            print_warning1 ("motors: left slips: %u\n", motors_left_count - motors_right_count);
         }
-        mark = clock;
-        for (;;) {
-            motors_left_timer = clock;
-            SynthOS_wait (clock != motors_left_timer || motors_action != left_action);
-            if (motors_action != left_action)
-                goto stop_motor;
-            new_value = qualify (left_encoder ());
-            if (new_value != 0 && new_value != value)
-                break;
-            if (clock - mark >= sector_maximum_delay)
-                do_power_down ("motors: left failed 3\n");
+        torque = pid_update (&pid, error);
+        if (torque != speed) {
+            print_debug2 ("motors: left speed: %u %u\n", middle, torque);
+            speed = torque;
+            left_motor_set (speed);
+            motors_left_wheel.torque = speed;
         }
-        clocks [index] = normalize (clock - last_clock, new_value);
-        last_clock = clock;
-        value = new_value;
-        index = (index + 1) % 3;
-        motors_left_count ++;
+        motors_left_wheel.saturated = speed == high_speed;
     }
 }
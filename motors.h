@@ -18,6 +18,8 @@
  * intact in all distributions and all future versions of this file
  * and the routines within it.
  */
+#include <stdint.h>
+
 typedef enum {
     motors_action_stop = 0,
     motors_action_forward,
@@ -31,6 +33,9 @@ void motors_left (void);
 void motors_right (void);
 void motors_forward (void);
 void motors_backward (void);
+void motors_wheels (uint8_t * torque, unsigned * middle);
+uint8_t motors_applied (uint32_t * time);
 
 extern volatile motors_action_t motors_action;
 extern volatile unsigned motors_left_count, motors_right_count;
+extern volatile uint8_t motors_slip;
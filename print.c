@@ -18,51 +18,202 @@
  * intact in all distributions and all future versions of this file
  * and the routines within it.
  */
-#include <string.h>
+#include <limits.h>
 
+#include "timer.h"
 #include "uart.h"
 #include "print.h"
 
+#if PRINT_BINARY
+
 /**
- *  @brief  SynthOS_call-style printing routine
- *
- *  We use a fixed number and  follow "printf" conventions otherwise. 
- *  UART is used as an output.  Some conversions are not supported.
- *
- *  Route all your printing through this function to avoid interleaving
- *  outputs.
+ * @brief  Puts a number into a record, LEB128
+ * @param  buf  where to put it
+ * @param  v  number
+ * @return  number of bytes taken
  */
-void print (long fmt, long a1, long a2, long a3)  {
-    /*
-     *  "Top digit first" integer-to-string conversion does not
-     *   need a buffer as we print what we get on every step.
-     *  
-     *   To get n such that b ^ (n + 1) > v, we use floor (v / b)
-     *   as a boundary:
-     *     v = b * x + y, y < b -> v - b * x < b                 (1)
-     *     d > x, integers -> d >= x + 1 -> d * b - x * b >= b   (2)
-     *     1,2 -> v - b * x < d * b - x * b -> v < d * b
-     */
-    char * s = (char*) (uintptr_t) fmt;
+static uint8_t print_number (uint8_t * buf, unsigned long v) {
+    uint8_t n = 0;
+
+    while (v >= 0x80) {
+        buf [n ++] = (uint8_t) v | 0x80;
+        v >>= 7;
+    }
+    buf [n ++] = (uint8_t) v;
+    return n;
+}
+
+/* Time of the previous record */
+static uint32_t print_last;
+
+/**
+ * @brief  Makes a binary log record (see print.h)
+ * @param  buf  where to put it, print_record_max bytes
+ * @param  fmt  format string
+ * @param  a1  first argument
+ * @param  a2  second argument
+ * @param  a3  third argument
+ * @return  record length
+ */
+uint8_t print_record (uint8_t * buf, long fmt, long a1, long a2, long a3) {
+    uint32_t now = timer_us () >> 10;
+    long args [3];
+    uint8_t n, count, i;
+
+    args [0] = a1;
+    args [1] = a2;
+    args [2] = a3;
+    for (count = 3; count > 0 && args [count - 1] == 0; count --)
+        ;
+    buf [0] = print_record_mark | count;
+    n = 1 + print_number (buf + 1, (unsigned long) fmt);
+    /* now is 22 bits wide, so is the difference across a wrap around */
+    n += print_number (buf + n, (now - print_last) & 0x3FFFFFUL);
+    print_last = now;
+    for (i = 0; i < count; i ++)
+        n += print_number (buf + n, ((unsigned long) args [i] << 1) ^
+                           (unsigned long) (args [i] >> (sizeof (long) * 8 - 1)));
+    return n;
+}
+
+#else
+
+/*
+ * Powers of 10 for the conversion by subtraction, the largest first.
+ * A 32 bit division is a library call of ~600 cycles on the AVR; a
+ * digit takes 4.5 subtractions on the average. The tables are in flash.
+ */
+static const unsigned long print_powers [] PROGMEM = {
+#if ULONG_MAX > 0xFFFFFFFFUL
+    10000000000000000000UL, 1000000000000000000UL, 100000000000000000UL,
+    10000000000000000UL, 1000000000000000UL, 100000000000000UL,
+    10000000000000UL, 1000000000000UL, 100000000000UL, 10000000000UL,
+#endif
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL
+};
+
+#define print_powers_count (sizeof (print_powers) / sizeof (print_powers [0]))
+
+/* The same for numbers that fit 16 bits */
+static const uint16_t print_powers16 [] PROGMEM = { 10000, 1000, 100, 10 };
+
+#define print_powers16_count (sizeof (print_powers16) / sizeof (print_powers16 [0]))
+
+/** @brief  Takes print_powers [i] from flash */
+static inline unsigned long print_power (uint8_t i) {
+#if ULONG_MAX > 0xFFFFFFFFUL
+    /* The host only, nothing is in flash there */
+    return print_powers [i];
+#else
+    return pgm_read_dword (&print_powers [i]);
+#endif
+}
+
+/** @brief  Longest number in digits */
+#define print_digits_max (sizeof (unsigned long) * 8 / 3 + 1)
+
+/**
+ * @brief  Converts a number to decimal digits
+ * @param  buf  where to put the digits, print_digits_max bytes
+ * @param  u  number
+ * @return  number of digits
+ */
+static uint8_t print_decimal (char * buf, unsigned long u) {
+    uint8_t i, n = 0;
+    uint16_t v, p;
+    unsigned long pl;
+    char c;
+
+    if (u <= 0xFFFF) {
+        v = (uint16_t) u;
+        for (i = 0; i < print_powers16_count; i ++) {
+            p = pgm_read_word (&print_powers16 [i]);
+            if (p <= v)
+                break;
+        }
+        for (; i < print_powers16_count; i ++) {
+            p = pgm_read_word (&print_powers16 [i]);
+            for (c = '0'; v >= p; c ++)
+                v -= p;
+            buf [n ++] = c;
+        }
+        buf [n ++] = '0' + (char) v;
+        return n;
+    }
+    /* Leading zeros are out of the question here */
+    for (i = 0; print_power (i) > u; i ++)
+        ;
+    for (; i < print_powers_count; i ++) {
+        pl = print_power (i);
+        for (c = '0'; u >= pl; c ++)
+            u -= pl;
+        buf [n ++] = c;
+    }
+    buf [n ++] = '0' + (char) u;
+    return n;
+}
+
+/**
+ * @brief  Converts a number to hexadecimal digits
+ * @param  buf  where to put the digits, print_digits_max bytes
+ * @param  u  number
+ * @param  h  'a' or 'A'
+ * @return  number of digits
+ */
+static uint8_t print_hex (char * buf, unsigned long u, char h) {
+    uint8_t shift = sizeof (u) * 8 - 4, n = 0;
+    char c;
+
+    while (shift != 0 && (u >> shift) == 0)
+        shift -= 4;
+    for (;; shift -= 4) {
+        c = (char) (u >> shift) & 0x0F;
+        buf [n ++] = c < 10 ? c + '0' : c - 10 + h;
+        if (shift == 0)
+            return n;
+    }
+}
+
+/* Appends a character to the message, the rest is cut off */
+#define print_put(c)                                                    \
+    do {                                                                \
+        if (len < print_message_max)                                    \
+            buf [len ++] = (c);                                         \
+    } while (0)
+
+/**
+ * @brief  Renders a message
+ * @param  buf  where to put it, print_message_max bytes
+ * @param  fmt  format string, in flash
+ * @param  a1  first argument
+ * @param  a2  second argument
+ * @param  a3  third argument
+ * @return  message length
+ */
+static uint8_t print_render (uint8_t * buf, long fmt, long a1, long a2, long a3) {
+    long args [3];
+    const char * s = (const char *) (uintptr_t) fmt;
     long * p = args;
 
-    char * ss, * xs, h;
+    const char * ss, * xs;
+    char h, digits [print_digits_max];
     unsigned w, n;
-    unsigned long u, x, d, b;
-    unsigned char c, f;
-    long args [3];
+    uint8_t len = 0;
+    unsigned long u;
+    unsigned char c, f, b, i;
 
     args [0] = a1;
     args [1] = a2;
     args [2] = a3;
 
-    while ((c = *s ++) != 0)
+    while ((c = pgm_read_byte (s ++)) != 0)
         switch (c) {
           case '%':
             ss = s;
-            c = *s ++;
+            c = pgm_read_byte (s ++);
             if (c == '%') {
-                uart_put_byte ('%');
+                print_put ('%');
                 break;
             }
             f = ' ';
@@ -71,10 +222,10 @@ void print (long fmt, long a1, long a2, long a3)  {
             w = 0;
             while (c >= '0' && c <= '9') {
                 w = c - '0';
-                c = *s ++;
+                c = pgm_read_byte (s ++);
             }
             if (c == 'l')
-                c = *s ++;
+                c = pgm_read_byte (s ++);
             if (c == 'u') {
                 u = *p ++;
                 b = 10;
@@ -83,7 +234,7 @@ void print (long fmt, long a1, long a2, long a3)  {
                 if (*p >= 0)
                     u = *p;
                 else {
-                    uart_put_byte ('-');
+                    print_put ('-');
                     u = - *p;
                 }
                 p ++;
@@ -100,54 +251,137 @@ void print (long fmt, long a1, long a2, long a3)  {
             } else  if (c == 'c') {
                 c = (char) (*p ++);
                 if (c == '\n') {
-                    uart_put_byte ('\r');
-                    uart_put_byte ('\n');
+                    print_put ('\r');
+                    print_put ('\n');
                     break;
                 }
                 while (w -- > 1)
-                    uart_put_byte (' ');
-                uart_put_byte (c);
+                    print_put (' ');
+                print_put (c);
                 break;
             } else  if (c == 's') {
-                xs = (char *) (uintptr_t) (*p ++);
-                n = strlen (xs);
+                xs = (const char *) (uintptr_t) (*p ++);
+                n = strlen_P (xs);
                 while (n ++ < w)
-                    uart_put_byte (' ');
-                while (*xs) {
-                    if (*xs == '\n')
-                        uart_put_byte ('\r');
-                    uart_put_byte (*xs ++);
+                    print_put (' ');
+                while ((c = pgm_read_byte (xs ++)) != 0) {
+                    if (c == '\n')
+                        print_put ('\r');
+                    print_put (c);
                 }
                 break;
             } else {
-                uart_put_byte ('%');
+                print_put ('%');
                 s = ss;
                 break;
             }
-            x = u /  b;
-            for (d = n = 1; d <= x; d *= b) 
-                n ++;
-            while (n ++ < w)
-                uart_put_byte (f);
-            while (d > 0) {
-                c = (unsigned char) (u / d);
-                if (c < 10)
-                    c += '0';
-                else
-                    c = c - 10 + h;
-                uart_put_byte (c);
-                u = u % d;
-                d /= b;
-            }
+            n = b == 10 ? print_decimal (digits, u) : print_hex (digits, u, h);
+            for (i = n; i < w; i ++)
+                print_put (f);
+            for (i = 0; i < n; i ++)
+                print_put (digits [i]);
             break;
           case '\n':
             ;
-            uart_put_byte ('\r');
-            uart_put_byte ('\n');
+            print_put ('\r');
+            print_put ('\n');
             break;
           default:
             ;
-            uart_put_byte (c);
+            print_put (c);
             break;
         }
+    return len;
+}
+
+#endif
+
+/**
+ * @brief  Makes a message
+ * @param  buf  where to put it, print_message_max bytes
+ * @param  fmt  format string, in flash
+ * @param  a1  first argument
+ * @param  a2  second argument
+ * @param  a3  third argument
+ * @return  message length
+ */
+static uint8_t print_make (uint8_t * buf, long fmt, long a1, long a2, long a3) {
+#if PRINT_BINARY
+    return print_record (buf, fmt, a1, a2, a3);
+#else
+    return print_render (buf, fmt, a1, a2, a3);
+#endif
+}
+
+#if PRINT_LOSSY
+
+unsigned print_dropped_messages, print_dropped_bytes;
+
+/* Dropped messages reported so far */
+static unsigned print_reported;
+
+/**
+ * @brief  Sends a message if it fits the UART buffer as a whole
+ * @param  fmt  format string, in flash
+ * @param  a1  first argument
+ * @param  a2  second argument
+ * @param  a3  third argument
+ * @return  0 if the message is sent, its length if it is dropped
+ */
+static uint8_t print_try (long fmt, long a1, long a2, long a3) {
+    uint8_t message [print_message_max], n;
+#if PRINT_BINARY
+    uint32_t last = print_last;
+#endif
+
+    n = print_make (message, fmt, a1, a2, a3);
+    if (n > uart_send_room ()) {
+#if PRINT_BINARY
+        /* The next record takes the time of this one */
+        print_last = last;
+#endif
+        return n;
+    }
+    uart_put_bytes (message, n);
+    return 0;
+}
+
+#endif
+
+/**
+ *  @brief  SynthOS_call-style printing routine
+ *
+ *  We use a fixed number and  follow "printf" conventions otherwise. 
+ *  UART is used as an output.  Some conversions are not supported.
+ *
+ *  Route all your printing through this function to avoid interleaving
+ *  outputs.
+ *
+ *  The format string and the %s strings are in flash (see print.h).
+ *  With PRINT_BINARY the message goes out as a record (see print.h).
+ *
+ *  The message is made in full before it is sent. With PRINT_LOSSY
+ *  it is dropped when it does not fit the UART buffer, so the call
+ *  never waits (see print.h).
+ */
+void print (long fmt, long a1, long a2, long a3)  {
+#if PRINT_LOSSY
+    uint8_t n = print_try (fmt, a1, a2, a3);
+
+    if (n != 0) {
+        print_dropped_messages ++;
+        print_dropped_bytes += n;
+        return;
+    }
+    /* There is room again, tell about the losses */
+    if (print_reported != print_dropped_messages &&
+        print_try ((uintptr_t) PSTR ("print: dropped %u messages, %u bytes\n"),
+                   print_dropped_messages, print_dropped_bytes, 0) == 0)
+        print_reported = print_dropped_messages;
+#else
+    uint8_t message [print_message_max], n;
+
+    n = print_make (message, fmt, a1, a2, a3);
+    uart_write (message, n);
+#endif
 }
@@ -22,17 +22,165 @@
  * -------------------------------------------------------------------
  * SynthOS does not support ellipses yet, so we have to use the following
  * macros.
+ *
+ * The format strings are kept in flash: the macros pass them through
+ * PSTR, so they have to be literals. A string printed with %s has to
+ * be in flash too (PSTR or PROGMEM).
+ *
+ * With PRINT_BINARY set to 1 the messages are not rendered on the
+ * target. Every print call sends a record instead:
+ *
+ * + a mark byte, print_record_mark plus the number of arguments sent
+ *   (trailing zero arguments are not sent)
+ * + the address of the format string
+ * + the time since the previous record, in 1024us units
+ * + the arguments, zigzag encoded (0, -1, 1, -2... -> 0, 1, 2, 3...)
+ *
+ * Numbers are unsigned LEB128 (7 bits per byte, low bits first, the
+ * top bit set on all the bytes but the last). work/host/logdecode
+ * takes the format strings out of the firmware image and prints the
+ * text.
+ *
+ * With PRINT_LOSSY set to 1 (the default) print never waits for the
+ * UART: a message that does not fit the send buffer as a whole is
+ * dropped. The drops are counted, and the next message that gets
+ * through is followed by "print: dropped N messages, M bytes" (the
+ * totals so far) when there is room for it. The time a call takes
+ * is bounded by the message length. With PRINT_LOSSY set to 0 print
+ * waits for room, which suits the tasks that must not lose output.
+ *
+ * The print_<level>0..3 macros are filtered at compile time. A call
+ * gets in only if its level is not above PRINT_LEVEL and the module
+ * of the source is in the PRINT_MODULES mask; otherwise it expands
+ * to nothing, the format string included, and its arguments are not
+ * evaluated. A source names its module by defining PRINT_MODULE
+ * before it includes print.h. Set the two with
+ * compiler_directives in project.sop, or with HOST_DEFINES for the
+ * host build:
+ *
+ *     -D PRINT_LEVEL=print_level_warning -D PRINT_MODULES=print_module_motors
+ *
+ * print0..print3 are not filtered.
  */
 #include <stdint.h>
 
+#include "aug-pgmspace.h"
+
+#ifndef PRINT_BINARY
+#define PRINT_BINARY 0
+#endif
+
+#ifndef PRINT_LOSSY
+#define PRINT_LOSSY 1
+#endif
+
+/* Longest text message in bytes, the rest is cut off */
+#ifndef PRINT_MESSAGE_MAX
+#define PRINT_MESSAGE_MAX 48
+#endif
+
+/** @brief  Record mark, the low 2 bits are the number of arguments */
+#define print_record_mark 0xA0
+
+/** @brief  Longest record */
+#define print_record_max (1 + 4 * (sizeof (long) * 8 + 6) / 7 + 5)
+
+/** @brief  Longest message print makes */
+#if PRINT_BINARY
+#define print_message_max print_record_max
+#else
+#define print_message_max PRINT_MESSAGE_MAX
+#endif
+
+uint8_t print_record (uint8_t * buf, long fmt, long a1, long a2, long a3);
+
+/** @brief  Messages (and their bytes) dropped with PRINT_LOSSY so far */
+extern unsigned print_dropped_messages, print_dropped_bytes;
+
 /** @brief Output format string \a fmt following printf conventions */
-#define print0(fmt) SynthOS_call (print ((uintptr_t)(fmt), 0, 0, 0))
+#define print0(fmt) SynthOS_call (print ((uintptr_t)(PSTR (fmt)), 0, 0, 0))
 
 /** @brief Output format string \a fmt following printf conventions and using \a a1 as argument */
-#define print1(fmt, a1) SynthOS_call (print ((uintptr_t)(fmt),  (a1), 0, 0))
+#define print1(fmt, a1) SynthOS_call (print ((uintptr_t)(PSTR (fmt)),  (a1), 0, 0))
 
 /** @brief Output format string \a fmt following printf conventions and using \a a1-a2 as arguments */
-#define print2(fmt, a1, a2) SynthOS_call (print ((uintptr_t)(fmt),  (a1),  (a2), 0))
+#define print2(fmt, a1, a2) SynthOS_call (print ((uintptr_t)(PSTR (fmt)),  (a1),  (a2), 0))
 
 /** @brief Output format string \a fmt following printf conventions and using \a a1-a3 as arguments */
-#define print3(fmt, a1, a2, a3) SynthOS_call (print ((uintptr_t)(fmt),  (a1),  (a2),  (a3)))
+#define print3(fmt, a1, a2, a3) SynthOS_call (print ((uintptr_t)(PSTR (fmt)),  (a1),  (a2),  (a3)))
+
+/* Log levels */
+#define print_level_none    0
+#define print_level_error   1
+#define print_level_warning 2
+#define print_level_info    3
+#define print_level_debug   4
+
+/* Modules */
+#define print_module_robot  0x01
+#define print_module_motors 0x02
+#define print_module_other  0x80
+#define print_module_all    0xFF
+
+#ifndef PRINT_LEVEL
+#define PRINT_LEVEL print_level_debug
+#endif
+
+#ifndef PRINT_MODULES
+#define PRINT_MODULES print_module_all
+#endif
+
+#ifndef PRINT_MODULE
+#define PRINT_MODULE print_module_other
+#endif
+
+/** @brief  Whether the calls of \a level get into the module */
+#define print_enabled(level) (PRINT_LEVEL >= (level) && (PRINT_MODULES & PRINT_MODULE) != 0)
+
+#if print_enabled (print_level_error)
+#define print_error0(fmt) print0 (fmt)
+#define print_error1(fmt, a1) print1 (fmt, a1)
+#define print_error2(fmt, a1, a2) print2 (fmt, a1, a2)
+#define print_error3(fmt, a1, a2, a3) print3 (fmt, a1, a2, a3)
+#else
+#define print_error0(fmt)
+#define print_error1(fmt, a1)
+#define print_error2(fmt, a1, a2)
+#define print_error3(fmt, a1, a2, a3)
+#endif
+
+#if print_enabled (print_level_warning)
+#define print_warning0(fmt) print0 (fmt)
+#define print_warning1(fmt, a1) print1 (fmt, a1)
+#define print_warning2(fmt, a1, a2) print2 (fmt, a1, a2)
+#define print_warning3(fmt, a1, a2, a3) print3 (fmt, a1, a2, a3)
+#else
+#define print_warning0(fmt)
+#define print_warning1(fmt, a1)
+#define print_warning2(fmt, a1, a2)
+#define print_warning3(fmt, a1, a2, a3)
+#endif
+
+#if print_enabled (print_level_info)
+#define print_info0(fmt) print0 (fmt)
+#define print_info1(fmt, a1) print1 (fmt, a1)
+#define print_info2(fmt, a1, a2) print2 (fmt, a1, a2)
+#define print_info3(fmt, a1, a2, a3) print3 (fmt, a1, a2, a3)
+#else
+#define print_info0(fmt)
+#define print_info1(fmt, a1)
+#define print_info2(fmt, a1, a2)
+#define print_info3(fmt, a1, a2, a3)
+#endif
+
+#if print_enabled (print_level_debug)
+#define print_debug0(fmt) print0 (fmt)
+#define print_debug1(fmt, a1) print1 (fmt, a1)
+#define print_debug2(fmt, a1, a2) print2 (fmt, a1, a2)
+#define print_debug3(fmt, a1, a2, a3) print3 (fmt, a1, a2, a3)
+#else
+#define print_debug0(fmt)
+#define print_debug1(fmt, a1)
+#define print_debug2(fmt, a1, a2)
+#define print_debug3(fmt, a1, a2, a3)
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         IR eye proximity guard
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * See proximity.h. The reflections are made by the ADC interrupt
+ * handler (see hardware.c), so the task only compares four numbers
+ * per reflection and the stop comes within ~20 ms of the reflection
+ * that makes an eye near.
+ */
+#include "events.h"
+#include "hardware.h"
+#include "motors.h"
+#include "print.h"
+#include "proximity.h"
+
+/** @brief  Eyes that are near, see proximity.h */
+volatile uint8_t proximity_eyes;
+
+/** @brief  Eyes that have stopped the motors; robot () clears it */
+volatile uint8_t proximity_alert;
+
+static const int16_t proximity_thresholds [eyes_count] = {
+    PROXIMITY_LEFT, PROXIMITY_TOP, PROXIMITY_RIGHT, PROXIMITY_BOTTOM
+};
+
+/**
+ * @brief  Proximity guard task
+ */
+void proximity () {
+    uint8_t sequence, i, near;
+    uint8_t hits [eyes_count];
+    int16_t v;
+
+    for (i = 0; i < eyes_count; i ++)
+        hits [i] = 0;
+    eyes_modulate (1);
+    sequence = eyes_sequence ();
+
+    for (;;) {
+        event_wait (event_proximity, eyes_sequence () != sequence);
+        sequence = eyes_sequence ();
+
+        near = 0;
+        for (i = 0; i < eyes_count; i ++) {
+            v = eye_reflection (i);
+            if (proximity_thresholds [i] == 0 ||
+                (i == eye_bottom ? v >= proximity_thresholds [i] : v < proximity_thresholds [i]))
+                hits [i] = 0;
+            else if (hits [i] < proximity_hits)
+                hits [i] ++;
+            if (hits [i] == proximity_hits)
+                near |= 1 << i;
+        }
+        proximity_eyes = near;
+
+        if (near != 0 && motors_action == motors_action_forward) {
+            motors_stop ();
+            proximity_alert |= near;
+            print_debug1 ("proximity: stop, eyes %x\n", near);
+        }
+    }
+}
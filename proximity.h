@@ -0,0 +1,68 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         IR eye proximity guard interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * The proximity task looks at every reflection the IR eyes get (see
+ * eyes_modulate), 50 times a second. An eye is "near" once its
+ * reflection has been at its threshold or above for proximity_hits
+ * reflections in a row; for the bottom eye, which looks at the floor,
+ * it is the other way around: the floor is gone once the reflection
+ * is below the threshold (0 turns that off).
+ *
+ * A near eye stops the motors right away if they are going forward,
+ * under remote control too, and leaves its bit in proximity_alert for
+ * robot () to steer away. proximity_eyes always has the eyes that are
+ * near.
+ *
+ * The thresholds are in ADC counts of the reflection alone and depend
+ * on the leds and the surfaces; the defaults are about 20 cm from a
+ * wall with the host world model.
+ */
+#ifndef PROXIMITY_H
+#define PROXIMITY_H
+
+#include <stdint.h>
+
+#ifndef PROXIMITY_LEFT
+#define PROXIMITY_LEFT 100
+#endif
+#ifndef PROXIMITY_TOP
+#define PROXIMITY_TOP 100
+#endif
+#ifndef PROXIMITY_RIGHT
+#define PROXIMITY_RIGHT 100
+#endif
+#ifndef PROXIMITY_BOTTOM
+#define PROXIMITY_BOTTOM 0
+#endif
+
+/** @brief  Reflections in a row an eye has to see */
+#define proximity_hits 2
+
+/** @brief  Eye bits, 1 << eye_xxx */
+#define proximity_left   0x01
+#define proximity_top    0x02
+#define proximity_right  0x04
+#define proximity_bottom 0x08
+
+extern volatile uint8_t proximity_eyes, proximity_alert;
+
+#endif
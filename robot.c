@@ -19,114 +19,449 @@
  * intact in all distributions and all future versions of this file
  * and the routines within it.
  */
+#define PRINT_MODULE print_module_robot
+
+#include <string.h>
+
 #include "print.h"
 #include "timer.h"
 #include "hardware.h"
 #include "util.h"
 #include "motors.h"
+#include "robot.h"
+#include "proximity.h"
 
 typedef enum {
-    pan_start                    =  600, /* pan pulse time in us */
-    pan_stop                     = 1800, /* pan pulse time in us */
+    pan_start                    = robot_pan_min, /* pan pulse time in us */
+    pan_stop                     = robot_pan_max, /* pan pulse time in us */
     pan_step                     =   15, /* pan pulse time in us */
-    pan_reset_pulses             =   25,
 #ifdef MIN_DISTANCE
     min_distance                 =   MIN_DISTANCE, /* in cm */
 #else
     min_distance                 =   30, /* in cm */
 #endif
-    incremental_pan_pulses       =    2,
     turn_step_count              =    5, /* in wheel sectors */
-    calibration_trigger_distance =    8  /* in cm */
+    calibration_trigger_distance =    8, /* in cm */
+    pan_slots                    = (pan_stop - pan_start) / pan_step + 1,
+    gap_minimum                  =   11, /* in pan steps, the rover passes at 42 cm */
+    scan_half_minimum            =  405, /* in us, 795 - 1605 us */
+    scan_step_maximum            = pan_step * 4,
+    sector_length                =   67, /* in 0.1 mm of track */
+    eye_side_offset              =  240, /* in us of pan, the side eyes look 36 degrees off */
 } values_type;
 
-unsigned robot_timer;
+/*
+ * Pan pulse time (1200 us is straight ahead, 600 us per 90 degrees)
+ * the rover turns by per wheel sector counted on both sides: the
+ * tracks are 13 cm apart and a sector is 0.67 cm of track.
+ */
+#ifndef ROBOT_TURN_US_PER_COUNT
+#define ROBOT_TURN_US_PER_COUNT 20
+#endif
+
+/* Range table entries */
+#define robot_range_unknown 0
+#define robot_range_clear   255
+
+/* Set by the command task (see robot.h) */
+volatile uint8_t robot_remote;
+
+/* Set while robot () sits out remote control (see robot.h) */
+volatile uint8_t robot_parked;
+
+/* A range request of the command task and the answer (see robot.h) */
+volatile uint8_t robot_range_wanted;
+volatile unsigned robot_range_value;
+
+/* Pulse time pan servo was last given */
+volatile unsigned robot_pan_position;
+
+/*
+ * The last distance seen at every pan step in cm, robot_range_clear
+ * if nothing was within the range gate, robot_range_unknown if it is
+ * not known in the current heading.
+ */
+static uint8_t robot_ranges [pan_slots];
+
+/**
+ * @brief  Decision distance
+ * @param  pos  pan pulse time in us
+ * @return  distance in cm; the sides need more room
+ */
+static unsigned robot_minimum (unsigned pos) {
+    return pos <= 800 || pos >= 1600 ? min_distance * 14 / 10 : min_distance;
+}
+
+/**
+ * @brief  Puts a measurement into the range table
+ * @param  pos  pan pulse time in us
+ * @param  val  distance in cm or ultrasonic_clear
+ */
+static void robot_record (unsigned pos, unsigned val) {
+    if (val == ultrasonic_clear)
+        val = robot_range_clear;
+    else if (val >= robot_range_clear)
+        val = robot_range_clear - 1;
+    else if (val == robot_range_unknown)
+        val = 1;
+    robot_ranges [(pos - pan_start) / pan_step] = (uint8_t) val;
+}
+
+/**
+ * @brief  Turns the range table with the rover
+ * @param  shift  number of pan steps, positive for a left turn
+ *
+ * What was seen at a pan position is that much further to the right
+ * after a left turn. The steps that come into view are unknown.
+ */
+static void robot_rotate (int shift) {
+    uint8_t i;
+
+    if (shift >= 0)
+        for (i = 0; i < pan_slots; i ++)
+            robot_ranges [i] = i + shift < pan_slots ? robot_ranges [i + shift] : robot_range_unknown;
+    else
+        for (i = pan_slots; i -- > 0;)
+            robot_ranges [i] = i >= - shift ? robot_ranges [i + shift] : robot_range_unknown;
+}
+
+/**
+ * @brief  Marks the range table where the IR eyes see something
+ * @param  eyes  proximity_xxx bits
+ *
+ * The sonar may miss what is that close, so a sector as wide as the
+ * narrowest gap around every eye is taken as blocked.
+ */
+static void robot_block (uint8_t eyes) {
+    uint8_t e, i, center;
+    unsigned pos;
+
+    for (e = eye_left; e <= eye_right; e ++) {
+        if ((eyes & (1 << e)) == 0)
+            continue;
+        if (e == eye_left)
+            pos = 1200 + eye_side_offset;
+        else if (e == eye_right)
+            pos = 1200 - eye_side_offset;
+        else
+            pos = 1200;
+        center = (pos - pan_start) / pan_step;
+        for (i = center - gap_minimum / 2; i <= center + gap_minimum / 2; i ++)
+            robot_ranges [i] = 1;
+    }
+}
+
+/**
+ * @brief  Finds the widest free sector in the range table
+ * @param  center  gets the pan pulse time of its middle
+ * @return  its width in pan steps
+ *
+ * Free means seen with nothing within the decision distance. Of the
+ * sectors as wide, the one closer to straight ahead wins.
+ */
+static uint8_t robot_gap (unsigned * center) {
+    uint8_t i, start = 0, width, best = 0;
+    unsigned pos, mid;
+
+    * center = 1200;
+    for (i = 0; i <= pan_slots; i ++) {
+        pos = pan_start + i * pan_step;
+        if (i < pan_slots && robot_ranges [i] != robot_range_unknown &&
+            robot_ranges [i] >= robot_minimum (pos))
+            continue;
+        width = i - start;
+        mid = pan_start + (start + i - 1) * pan_step / 2;
+        if (width > best || (width == best && width != 0 &&
+            (mid > 1200 ? mid - 1200 : 1200 - mid) < (* center > 1200 ? * center - 1200 : 1200 - * center))) {
+            best = width;
+            * center = mid;
+        }
+        start = i + 1;
+    }
+    return best;
+}
+
+/**
+ * @brief  Finds the closest object in the range table
+ * @return  pan pulse time it was seen at
+ */
+static unsigned robot_closest (void) {
+    uint8_t i, best = 0;
+
+    for (i = 1; i < pan_slots; i ++)
+        if (robot_ranges [i] != robot_range_unknown &&
+            (robot_ranges [best] == robot_range_unknown || robot_ranges [i] < robot_ranges [best]))
+            best = i;
+    return pan_start + best * pan_step;
+}
+
+/**
+ * @brief  Tells whether the way straight ahead is known to be free
+ */
+static uint8_t robot_ahead_free (void) {
+    uint8_t i;
+
+    for (i = (pan_slots - gap_minimum) / 2; i < (pan_slots + gap_minimum) / 2; i ++)
+        if (robot_ranges [i] == robot_range_unknown ||
+            robot_ranges [i] < robot_minimum (pan_start + i * pan_step))
+            return 0;
+    return 1;
+}
+
+/**
+ * @brief  Tells how long a sweep step takes
+ * @param  step  pan step in us
+ * @return  time in ms, rounded up
+ */
+static unsigned long robot_step_time (unsigned step) {
+    return pan_travel (step) / 1000 + 1;
+}
+
+/**
+ * @brief  Plans the next sweep
+ * @param  lo  gets the pan pulse time to turn back at on the right
+ * @param  hi  gets the pan pulse time to turn back at on the left
+ * @return  pan step in us
+ *
+ * After a stop every step of the full range is looked at. On the move
+ * the rover should not get further than a budget during a sweep:
+ * a quarter of min_distance plus what is left of the closest distance
+ * ahead above it. What the sweep takes at the speed the wheel sectors
+ * show is first taken off the sides, down to 795 - 1605 us, and then
+ * by making the step coarser, as far as the longer moves still save
+ * time.
+ */
+static unsigned robot_plan (unsigned * lo, unsigned * hi) {
+    uint8_t torque [2], i;
+    unsigned middle [2], ahead, budget, half, step;
+    unsigned long steps, time;
+
+    * lo = pan_start;
+    * hi = pan_stop;
+    if (motors_action != motors_action_forward)
+        return pan_step;
+    motors_wheels (torque, middle);
+    if (middle [0] == 0 || (middle [1] != 0 && middle [1] < middle [0]))
+        middle [0] = middle [1];
+    if (middle [0] == 0)
+        /* Just started, what is around was seen a moment ago */
+        middle [0] = 1;
+
+    ahead = min_distance * 14 / 10;
+    for (i = (1200 - scan_half_minimum - pan_start) / pan_step;
+         i <= (1200 + scan_half_minimum - pan_start) / pan_step; i ++)
+        if (robot_ranges [i] != robot_range_unknown && robot_ranges [i] < ahead)
+            ahead = robot_ranges [i];
+    budget = min_distance / 4 + (ahead > min_distance ? ahead - min_distance : 0);
+    if (budget > min_distance)
+        budget = min_distance;
+
+    /* Time in ms that takes the rover that far */
+    time = (unsigned long) budget * 100 * middle [0] / sector_length;
+    steps = time / robot_step_time (pan_step);
+    if (steps >= (pan_stop - pan_start) / pan_step)
+        return pan_step;
+    half = (unsigned) steps / 2 * pan_step;
+    step = pan_step;
+    if (half < scan_half_minimum) {
+        half = scan_half_minimum;
+        /* A coarser step is fewer moves, but every move is longer */
+        while (step < scan_step_maximum &&
+               2 * half / step * robot_step_time (step) > time)
+            step += pan_step;
+    }
+    * lo = 1200 - half;
+    * hi = 1200 + half;
+    return step;
+}
+
+/**
+ * @brief  Moves pan servo, returns right away
+ * @param  duration  pulse duration in microseconds
+ *
+ * The servo is kept there in the background (see pan_set).
+ */
+void robot_pan (unsigned duration) {
+    robot_pan_position = duration;
+    pan_set (duration);
+}
 
 /**
  * @brief  Drives pan servo
  * @param  duration  pulse duration in microseconds
- * @param  count  number of pulses to send
+ *
+ * Takes as long as the servo needs to get there from where it was
+ * last sent (see pan_set_model).
  */
-void drive_pan (unsigned duration, unsigned count) {
-    unsigned i, start;
-
-    for (i = 0; i < count; i ++) {
-        pan_pulse (duration);
-        /* Wait 20 ms, let servo work */
-        start = pclock ();
-        robot_timer = clock;
-        /* Sleep first */
-        SynthOS_wait (clock - robot_timer >= 2);
-        /* Spin for the rest of the required time */
-        while (pdiff (start, pclock ()) < 2 * clock_divider)
-            SynthOS_sleep ();
-    }
+void drive_pan (unsigned duration) {
+    robot_pan (duration);
+    SynthOS_wait (pan_reached ());
 }
 
 /**
  * @brief  Scanning and high level motion control function
  *
  * This function starts the motion and constantly scans the surroundings
- * using the ultrasonic sensor. Whenever we detected an object that is
- * close than "min_distance", we make left turn, stop and do a scanning
- * If nothing was is found during the turn, we move forward again.
- * Otherwise, we make another left turn and repeat the full scanning turn.
+ * using the ultrasonic sensor, keeping the last distance seen at every
+ * pan step in robot_ranges. Whenever we detected an object that is
+ * close than "min_distance", we stop and do a full scanning turn. Then
+ * we turn to the middle of the widest free sector and, as the table
+ * turns with us, move forward right away. If there is no sector wide
+ * enough to pass, we make a left turn and repeat the full scanning turn.
  * The basic constraints are:
  * 1. The scanning step should not be too big otherwise we can miss
  *    something.
  * 2. "min_distance" should be big enough so we would have time to
  *    make a full scan before hitting the object.
+ *
+ * On the move the sweep is narrowed and made coarser as the rover goes
+ * faster (see robot_plan); after a stop it covers the full range.
+ *
+ * The pan servo is refreshed in the background, so a step is given
+ * to it right after the ping and moves while the echo is in flight.
+ *
+ * The IR eyes (see proximity.h) stop the motors on their own; we do
+ * a full scanning turn then as well and take the sectors they look at
+ * as blocked.
+ *
+ * Under remote control (robot_remote, see command.c) we only keep the
+ * pan servo where it was told and start over when it is given back.
+ * Otherwise the range requests of the command task are measured here,
+ * between two steps (see robot.h).
  */
 void robot () {
-    int dir;
-    unsigned pos, val, min;
+    int dir, shift;
+    uint8_t eyes = 0;
+    unsigned pos, next, val, center, count, lo, hi, step;
 
     /* To calibrate the center position, put your hand in front of the
      * sensor (not further away than calibration_trigger_distance) and turn the power.
      */
     val = SynthOS_call (ultrasonic_measure ());
     if (val <= calibration_trigger_distance) {
-        SynthOS_call (drive_pan (pan_stop, pan_reset_pulses));
-        SynthOS_call (drive_pan (pan_start, pan_reset_pulses));
-        SynthOS_call (drive_pan ((pan_start + pan_stop) / 2, pan_reset_pulses));
+        SynthOS_call (drive_pan (pan_stop));
+        SynthOS_call (drive_pan (pan_start));
+        SynthOS_call (drive_pan ((pan_start + pan_stop) / 2));
         do_power_down ("Calibration\n");
     }
 
-    SynthOS_call (drive_pan (pan_start, pan_reset_pulses));
+    /* Nothing further than the largest decision distance matters */
+    ultrasonic_set_range (min_distance * 14 / 10);
+
+    SynthOS_call (drive_pan (pan_start));
 
-    pos = pan_start;
-    dir = pan_step;
+    pos = lo = pan_start;
+    hi = pan_stop;
+    dir = step = pan_step;
     for (;;) {
-        SynthOS_call (drive_pan (pos, incremental_pan_pulses));
-        for (;;) {
-            val = SynthOS_call (ultrasonic_measure ());
-            if (pos <= 800 || pos >= 1600)
-                min = min_distance * 14 / 10;
-            else
-                min = min_distance;
-            if (val >= min)
-                break;
+        if (robot_remote) {
+            /* The servo holds what it was told by itself */
+            robot_parked = 1;
+            SynthOS_wait (! robot_remote);
+            robot_parked = 0;
+            ultrasonic_set_range (min_distance * 14 / 10);
+            motors_stop ();
+            memset (robot_ranges, robot_range_unknown, sizeof (robot_ranges));
+            proximity_alert = 0;
+            SynthOS_call (drive_pan (pan_start));
+            pos = pan_start;
+            dir = pan_step;
+            continue;
+        }
+        if (proximity_alert) {
+            /* The IR eyes have stopped us (see proximity.h) */
+            eyes |= proximity_alert;
+            print_debug1 ("robot: stop, eyes %u\n", eyes);
+            proximity_alert = 0;
+            motors_stop ();
+            SynthOS_call (drive_pan (pan_start));
+            pos = pan_start;
+            dir = pan_step;
+            continue;
+        }
+        if (robot_range_wanted) {
+            /* The command task wants the whole range where we look */
+            ultrasonic_set_range (0);
+            robot_range_value = SynthOS_call (ultrasonic_measure ());
+            ultrasonic_set_range (min_distance * 14 / 10);
+            robot_range_wanted = 0;
+        }
+        ultrasonic_start ();
+        if (pos >= hi || pos <= lo)
+            step = robot_plan (&lo, &hi);
+        if (pos >= hi)
+            dir = - (int) step;
+        else if (pos <= lo)
+            dir = step;
+        else
+            dir = dir < 0 ? - (int) step : (int) step;
+        next = pos + dir;
+        if (pos >= lo && pos <= hi) {
+            /* The last step to an end of the window may be shorter */
+            if (next > hi)
+                next = hi;
+            else if (next < lo)
+                next = lo;
+        }
+        robot_pan (next);
+        val = SynthOS_call (ultrasonic_wait ());
+        if (robot_remote)
+            continue;
+        robot_record (pos, val);
+        if (val < robot_minimum (pos) && motors_action == motors_action_forward) {
             /* We detected an object that is close than "min_distance" */
-            print1 ("robot: left, got %u\n", val);
-            motors_left ();
-            SynthOS_wait (motors_left_count + motors_right_count >= turn_step_count);
+            print_debug1 ("robot: stop, got %u\n", val);
             motors_stop ();
             /* Turn to the initial scanning position */
-            SynthOS_call (drive_pan (pan_start, pan_reset_pulses));
+            SynthOS_call (drive_pan (pan_start));
             pos = pan_start;
             dir = pan_step;
+            continue;
         }
-        if (pos >= pan_stop) {
-            dir = - pan_step;
-            if (motors_action != motors_action_forward) {
-                /* We made a full turn while scanning surroundings after a stop and found no
-                   object that are close to us so we can resume moving forward. */
-                print0 ("robot: forward\n");
-                motors_forward ();
+        if (pos >= pan_stop && motors_action != motors_action_forward) {
+            /* We made a full turn while scanning surroundings after a stop */
+            robot_block (eyes | proximity_eyes);
+            eyes = 0;
+            if (robot_gap (&center) >= gap_minimum) {
+                /* Head for the middle of the widest free sector */
+                count = (center > 1200 ? center - 1200 : 1200 - center) / ROBOT_TURN_US_PER_COUNT;
+                if (count < turn_step_count) {
+                    /* It is ahead already, step away from what stopped us */
+                    center = robot_closest () < 1200 ? 1200 + 1 : 1200 - 1;
+                    count = turn_step_count;
+                }
+                print_debug1 ("robot: turn to %u\n", center);
+                if (center > 1200)
+                    motors_left ();
+                else
+                    motors_right ();
+            } else {
+                /* No way out in sight, turn and look again */
+                print_debug0 ("robot: left\n");
+                center = 1200 + 1;
+                count = turn_step_count;
+                motors_left ();
             }
-        } else 
-            if (pos <= pan_start)
+            SynthOS_wait (robot_remote || motors_left_count + motors_right_count >= count);
+            if (robot_remote)
+                continue;
+            count = motors_left_count + motors_right_count;
+            motors_stop ();
+            shift = (int) ((count * ROBOT_TURN_US_PER_COUNT + pan_step / 2) / pan_step);
+            robot_rotate (center > 1200 ? shift : - shift);
+            if (! robot_ahead_free ()) {
+                SynthOS_call (drive_pan (pan_start));
+                pos = pan_start;
                 dir = pan_step;
-        pos += dir;
+                continue;
+            }
+            /* Nothing close to us in the way so we can resume moving forward. */
+            print_info0 ("robot: forward\n");
+            motors_forward ();
+            /* Plan the sweep for the move */
+            lo = hi = 1200;
+        }
+        pos = next;
+        SynthOS_wait (robot_remote || pan_reached ());
     }
 }
@@ -0,0 +1,51 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Surroundings scanning and high level motion control
+ *                module interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * While robot_remote is set, robot () leaves the motors, the
+ * ultrasonic sensor and the pan servo alone (the servo keeps
+ * robot_pan_position by itself, see pan_set); the command task (see
+ * command.h) is in charge. It takes robot () a moment to get there,
+ * for one when a measurement is in flight: robot_parked is set once it
+ * has.
+ *
+ * Otherwise the command task asks robot () for a range by setting
+ * robot_range_wanted. robot () makes an ungated measurement between
+ * two steps of its sweep, leaves it in robot_range_value and clears
+ * the flag.
+ */
+#ifndef ROBOT_H
+#define ROBOT_H
+
+#include <stdint.h>
+
+/** @brief  Pan pulse time range in us */
+#define robot_pan_min  600
+#define robot_pan_max 1800
+
+extern volatile uint8_t robot_remote, robot_parked;
+extern volatile unsigned robot_pan_position, robot_range_value;
+extern volatile uint8_t robot_range_wanted;
+
+void robot_pan (unsigned duration);
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Control loop telemetry
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * The frame layout is in telemetry.h. A sample takes a fixed amount
+ * of work (no loops but over the frame bytes) and never waits for
+ * the UART, so its cost is bounded; the cost of every sample is
+ * measured with Timer 1 and sent in the next one.
+ */
+#include <avr/io.h>
+
+#include "events.h"
+#include "timer.h"
+#include "uart.h"
+#include "hardware.h"
+#include "motors.h"
+#include "robot.h"
+#include "command.h"
+#include "telemetry.h"
+
+volatile uint16_t telemetry_period = TELEMETRY_PERIOD;
+unsigned telemetry_dropped;
+
+static timer_type telemetry_timer;
+
+/* Time the previous sample took, in Timer 1 steps */
+static uint16_t telemetry_last_cost;
+
+/**
+ * @brief  Sets the period
+ * @param  period  in ms, 0 - off; shorter than telemetry_period_min is taken as that
+ */
+void telemetry_set_period (uint16_t period) {
+    if (period != 0 && period < telemetry_period_min)
+        period = telemetry_period_min;
+    telemetry_period = period;
+}
+
+static void telemetry_put16 (uint8_t * data, uint8_t offset, uint16_t v) {
+    data [offset] = (uint8_t) v;
+    data [offset + 1] = (uint8_t) (v >> 8);
+}
+
+/**
+ * @brief  Makes a sample and sends it if the UART buffer has room
+ * @param  sequence  sequence number
+ */
+static void telemetry_sample (uint8_t sequence) {
+    uint8_t data [telemetry_size], frame [2 * telemetry_size + 6], torque [2], n;
+    uint16_t start = TCNT1;
+    uint32_t now = timer_us ();
+    unsigned middle [2];
+
+    motors_wheels (torque, middle);
+    data [telemetry_sequence] = sequence;
+    data [telemetry_type] = telemetry_frame_type;
+    telemetry_put16 (data, telemetry_time, (uint16_t) now);
+    telemetry_put16 (data, telemetry_time + 2, (uint16_t) (now >> 16));
+    data [telemetry_action] = motors_action;
+    data [telemetry_flags] = (motors_slip ? telemetry_flag_slip : 0) |
+                             (robot_remote ? telemetry_flag_remote : 0);
+    telemetry_put16 (data, telemetry_left_count, motors_left_count);
+    telemetry_put16 (data, telemetry_right_count, motors_right_count);
+    data [telemetry_left_torque] = torque [0];
+    data [telemetry_right_torque] = torque [1];
+    telemetry_put16 (data, telemetry_left_middle, middle [0]);
+    telemetry_put16 (data, telemetry_right_middle, middle [1]);
+    telemetry_put16 (data, telemetry_pan, robot_pan_position);
+    telemetry_put16 (data, telemetry_range, ultrasonic_last (0));
+    telemetry_put16 (data, telemetry_cost, telemetry_last_cost);
+
+    n = command_encode (frame, data, telemetry_size);
+    if (n <= uart_send_room ())
+        uart_put_bytes (frame, n);
+    else
+        telemetry_dropped ++;
+    telemetry_last_cost = TCNT1 - start;
+}
+
+/**
+ * @brief  Telemetry task
+ *
+ * The samples keep to the period even if the task wakes up late;
+ * after a long delay (or a change of the period) it starts over.
+ */
+void telemetry () {
+    uint32_t next = 0, now;
+    uint8_t sequence = 0;
+    uint16_t period;
+
+    for (;;) {
+        SynthOS_wait (telemetry_period != 0);
+        period = telemetry_period;
+        next += (uint32_t) period * 1000;
+        now = timer_us ();
+        if ((int32_t) (next - now) <= 0 || (int32_t) (next - now) > (int32_t) period * 1000)
+            next = now + (uint32_t) period * 1000;
+        timer_start (&telemetry_timer, next);
+        SynthOS_wait (telemetry_timer.expired);
+        telemetry_sample (sequence ++);
+    }
+}
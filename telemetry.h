@@ -0,0 +1,91 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        agent
+ * @date          10-17-2026
+ *
+ * @brief         Control loop telemetry interface
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * -------------------------------------------------------------------
+ * Every telemetry_period ms the telemetry task sends a sample of the
+ * control loops as a frame of the command channel (see command.h,
+ * SLIP and CRC the same way). The contents are at fixed offsets,
+ * little endian:
+ *
+ *     telemetry_sequence       8 bits, counts the samples made
+ *     telemetry_type           telemetry_frame_type
+ *     telemetry_time           32 bits, timer_us of the sample
+ *     telemetry_action         motors_action
+ *     telemetry_flags          telemetry_flag_xxx
+ *     telemetry_left_count     16 bits, motors_left_count
+ *     telemetry_right_count    16 bits, motors_right_count
+ *     telemetry_left_torque    8 bits, PWM counts
+ *     telemetry_right_torque   8 bits, PWM counts
+ *     telemetry_left_middle    16 bits, sector period in ms, 0 - not known
+ *     telemetry_right_middle   16 bits
+ *     telemetry_pan            16 bits, pan pulse time in us
+ *     telemetry_range          16 bits, last distance in cm or ultrasonic_clear
+ *     telemetry_cost           16 bits, time the previous sample took, in 0.5 us
+ *
+ * A sample that does not fit the UART buffer is dropped (counted in
+ * telemetry_dropped) instead of making the task wait; the gap shows
+ * in the sequence. The period can be changed at run time with
+ * command_telemetry.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+/** @brief  Initial period in ms, 0 - off */
+#ifndef TELEMETRY_PERIOD
+#define TELEMETRY_PERIOD 0
+#endif
+
+/** @brief  Shortest period in ms */
+#define telemetry_period_min 20
+
+#define telemetry_frame_type 0x54
+
+/** @brief  Flags */
+#define telemetry_flag_slip   0x01   /* motors_slip */
+#define telemetry_flag_remote 0x02   /* robot_remote */
+
+/** @brief  Offsets in the frame */
+typedef enum {
+    telemetry_sequence     =  0,
+    telemetry_type         =  1,
+    telemetry_time         =  2,
+    telemetry_action       =  6,
+    telemetry_flags        =  7,
+    telemetry_left_count   =  8,
+    telemetry_right_count  = 10,
+    telemetry_left_torque  = 12,
+    telemetry_right_torque = 13,
+    telemetry_left_middle  = 14,
+    telemetry_right_middle = 16,
+    telemetry_pan          = 18,
+    telemetry_range        = 20,
+    telemetry_cost         = 22,
+    telemetry_size         = 24   /* without the CRC */
+} telemetry_offset_type;
+
+extern volatile uint16_t telemetry_period;
+extern unsigned telemetry_dropped;
+
+void telemetry_set_period (uint16_t period);
+
+#endif
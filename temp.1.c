@@ -0,0 +1,576 @@
+/**
+ * @addtogroup    DFRobot
+ * @{
+ * @file
+ * @author        Igor Serikov
+ * @date          07-29-2014
+ *
+ * @brief         Motors control module
+ *
+ * @copyright
+ * Copyright (c) 2014 Zeidman Technologies, Inc.
+ * 15565 Swiss Creek Lane, Cupertino California, 95014 
+ * All Rights Reserved
+ *
+ * @copyright
+ * Zeidman Technologies gives an unlimited, nonexclusive license to
+ * use this code  as long as this header comment section is kept
+ * intact in all distributions and all future versions of this file
+ * and the routines within it.
+ *
+ * Notes
+ * --------------------------------------------------------
+ * All the routines beside motors_stop reset the left and 
+ * right counters.
+ */
+#define PRINT_MODULE print_module_motors
+
+#include "events.h"
+#include "fixed.h"
+#include "timer.h"
+#include "hardware.h"
+#include "print.h"
+#include "motors.h"
+#include "util.h"
+
+/* Sector period the speed controller keeps, in ms (the cruise speed) */
+#ifndef MOTORS_TIME_TARGET
+#define MOTORS_TIME_TARGET 280
+#endif
+
+/* 
+ * We need to apply a higher torque when turn
+ * The speed of the robot greatly depends on the
+ * battery charge. DO NOT use power supply with
+ * these xxx_speed_yyy values.
+ */
+typedef enum {
+    low_speed_normal           =  80, /* in a part of 255 */
+    high_speed_normal          = 100, /* in a part of 255 */
+    low_speed_turn             = 120, /* in a part of 255 */
+    high_speed_turn            = 140, /* in a part of 255 */
+    time_target                = MOTORS_TIME_TARGET, /* in ms */
+    time_tolerance             =   6, /* in ms */
+    sector_maximum_delay       = 3000, /* in ms */
+} motors_values_type;
+
+/*
+ * Speed controller gains in PWM counts per ms of the sector period
+ * error, with 8 fraction bits. The integral gain applies once per
+ * sector.
+ */
+#ifndef MOTORS_KP
+#define MOTORS_KP 12
+#endif
+#ifndef MOTORS_KI
+#define MOTORS_KI 12
+#endif
+#ifndef MOTORS_KD
+#define MOTORS_KD 0
+#endif
+
+/*
+ * Cross-coupling gain: ms of period error per ms one wheel is ahead of
+ * the other, with 8 fraction bits
+ */
+#ifndef MOTORS_KS
+#define MOTORS_KS 8
+#endif
+
+/* The wheels are slipping when their sector counts differ by more */
+#ifndef MOTORS_SLIP_COUNT
+#define MOTORS_SLIP_COUNT 4
+#endif
+
+/**
+ * @brief Speed controller state
+ *
+ * The integral term carries the operating point, so it starts
+ * at the initial torque.
+ */
+typedef struct {
+    long integral;      /* in PWM counts, 8 fraction bits */
+    int error;          /* previous error, in ms */
+    uint8_t low, high;  /* output range, in PWM counts */
+} motors_pid_type;
+
+/**
+ * @brief  Last request made to the module via motors_xxx
+ * 
+ * Do not write to this variable directly.
+ */
+volatile motors_action_t motors_action;
+
+/** @brief Wheel sector counters */
+volatile unsigned motors_left_count, motors_right_count;
+
+/** @brief Set when the wheel sector counts diverge, see MOTORS_SLIP_COUNT */
+volatile uint8_t motors_slip;
+
+/**
+ * @brief Wheel progress the other motor task keeps up with
+ *
+ * Openings and bridges are not equal (see normalize), so the distance
+ * is in fifths of an average sector: 4 for the sectors ending with
+ * level 1 and 6 for the others.
+ */
+typedef struct {
+    uint32_t time;      /* when the wheel passed its last sector, see timer_us */
+    unsigned distance;  /* in 1/5 of a sector */
+    unsigned middle;    /* sector period in ms, 0 - not known yet */
+    int8_t level;       /* level the last sector ended with */
+    uint8_t saturated;  /* the torque is at its highest */
+    uint8_t torque;     /* in PWM counts, 0 - the motor is off */
+    motors_action_t action;  /* what the task has put on the motor */
+    uint32_t action_time;    /* and when, see timer_us */
+} motors_wheel_type;
+
+static motors_wheel_type motors_left_wheel, motors_right_wheel;
+
+/** @brief Module initialization routine */
+static void motors_init (void) __attribute__ ((constructor));
+static void motors_init (void) {
+    motors_action = motors_action_stop;
+    motors_left_count = motors_right_count = 0;
+}
+
+/** @brief Starts counting the sectors of a new movement */
+static void motors_reset (void) {
+    motors_left_count = motors_right_count = 0;
+    motors_left_wheel.distance = motors_right_wheel.distance = 0;
+    motors_left_wheel.middle = motors_right_wheel.middle = 0;
+    motors_left_wheel.saturated = motors_right_wheel.saturated = 0;
+    motors_slip = 0;
+}
+
+/**
+ * @brief  Reports the state of the speed controllers
+ * @param  torque  gets the torques of the left and the right wheel in PWM counts
+ * @param  middle  gets their sector periods in ms, 0 - not known
+ */
+void motors_wheels (uint8_t * torque, unsigned * middle) {
+    torque [0] = motors_left_wheel.torque;
+    torque [1] = motors_right_wheel.torque;
+    middle [0] = motors_left_wheel.middle;
+    middle [1] = motors_right_wheel.middle;
+}
+
+/**
+ * @brief  Tells whether both motor tasks have put motors_action on the motors
+ * @param  time  gets the timer_us of the later one, if they have
+ * @return  not 0 if they have
+ */
+uint8_t motors_applied (uint32_t * time) {
+    motors_action_t action = motors_action;
+
+    if (motors_left_wheel.action != action || motors_right_wheel.action != action)
+        return 0;
+    *time = motors_left_wheel.action_time;
+    if ((int32_t) (motors_right_wheel.action_time - *time) > 0)
+        *time = motors_right_wheel.action_time;
+    return 1;
+}
+
+/** @brief Wakes both motor tasks up, "motors_action" has changed */
+static void motors_signal (void) {
+    event_signal (event_motors_left);
+    event_signal (event_motors_right);
+}
+
+/** @brief Stops the motors */
+void motors_stop (void) {
+    motors_action = motors_action_stop;
+    motors_signal ();
+}
+
+/** @brief Starts left turn */
+void motors_left (void) {
+    motors_action = motors_action_left;
+    motors_signal ();
+    motors_reset ();
+}
+
+/** @brief Starts right turn */
+void motors_right (void) {
+    motors_action = motors_action_right;
+    motors_signal ();
+    motors_reset ();
+}
+
+/** @brief Starts forward motion */
+void motors_forward (void) {
+    motors_action = motors_action_forward;
+    motors_signal ();
+    motors_reset ();
+}
+
+/** @brief Starts backward motion */
+void motors_backward (void) {
+    motors_action = motors_action_backward;
+    motors_signal ();
+    motors_reset ();
+}
+
+/**
+ * @brief Gets a middle value out of three consecutive values
+ *
+ * Example: 6 2 5 -> 5
+ *
+ * @param  a  circular array containing 4 readings
+ * @param  p  starting position
+ * @return  middle value
+ */
+static unsigned get_middle (unsigned a [3], unsigned p) {
+    unsigned v1 = a [p], v2 = a [(p + 1) % 3], v3 = a [(p + 2) % 3];
+    if (v1 <= v2) {
+        if (v2 <= v3)
+            return v2; /* v1 <= v2 <= v3 */
+        if (v1 <= v3)
+            return v3; /* v1 <= v3 < v2 */
+        return v1; /* v3 < v1 <= v2 */
+    }
+    if (v1 <= v3)
+        return v1; /* v2 < v1 <= v3 */
+    if (v2 <= v3)
+        return v3; /* v2 <= v3 < v1 */
+    return v2; /* v3 < v2 < v1 */
+}
+
+/**
+ * @brief Interval normalization
+ *
+ * In the encoder wheel, openings and bridges are
+ * not equal in angle. This function pefrorm the
+ * necessary timing normalization.
+ * @param  t  timing
+ * @return  q  opening/bridge indicator 
+ *          (-1/1, we did not check what corresponds to what)
+ * @return  normalized value
+ */
+static unsigned normalize (unsigned t, int q) {
+    return fixed_scale (t, q > 0 ? fixed_q (5, 4, 8) : fixed_q (5, 6, 8), 8);
+}
+
+/**
+ * @brief Starts the speed controller
+ * @param  pid  controller state
+ * @param  low  initial and lowest torque
+ * @param  high  highest torque
+ */
+static void pid_start (motors_pid_type * pid, uint8_t low, uint8_t high) {
+    pid->integral = (long) low << 8;
+    pid->error = 0;
+    pid->low = low;
+    pid->high = high;
+}
+
+/**
+ * @brief Computes the torque for the next sector
+ * @param  pid  controller state
+ * @param  error  sector period minus the target, in ms
+ *         (positive - we move too slow)
+ * @return  torque
+ */
+static uint8_t pid_update (motors_pid_type * pid, int error) {
+    long low = (long) pid->low << 8, high = (long) pid->high << 8, out;
+
+    /* Anti-windup: the integral alone never leaves the output range */
+    pid->integral += (long) MOTORS_KI * error;
+    if (pid->integral < low)
+        pid->integral = low;
+    else if (pid->integral > high)
+        pid->integral = high;
+
+    out = pid->integral + (long) MOTORS_KP * error +
+        (long) MOTORS_KD * (error - pid->error);
+    pid->error = error;
+    if (out < low)
+        out = low;
+    else if (out > high)
+        out = high;
+    return (uint8_t) ((out + 128) >> 8);
+}
+
+/**
+ * @brief Cross-coupling term of the speed controller
+ *
+ * The other wheel's distance is extrapolated from its last sector and
+ * its period, so the term does not jump by a whole sector whenever
+ * one of the wheels passes an edge.
+ *
+ * @param  wheel  this wheel, it has just passed a sector
+ * @param  other  the other wheel
+ * @return  period error correction in ms (positive - this wheel is behind)
+ */
+static int motors_sync (const motors_wheel_type * wheel, const motors_wheel_type * other) {
+    uint32_t part;
+    unsigned length;
+    long lead;
+
+    if (other->middle == 0)
+        return 0;
+    /* How far the other wheel went into the sector it is in now */
+    length = other->level > 0 ? 6 : 4;
+    part = (wheel->time - other->time) * 5 / (other->middle * 1000UL);
+    if (part > length)
+        part = length;
+    /* How long (ms) this wheel is ahead of the other */
+    lead = ((long) (int) (wheel->distance - other->distance) - (long) part) * other->middle / 5;
+    return (int) (- lead * MOTORS_KS / 256);
+}
+
+/* Everything below the cut line would be duplicated with "left" <-> "right"
+   substitution. */
+/* --- cut --- */
+
+timer_type motors_left_timer;
+motors_action_t left_action;
+
+/**
+ * @brief motor control function.
+ *
+ * Duplicating this function we get two functions:
+ * one for the left motor and one for the right. The function controlled by setting
+ * "motors_action". After the movement started, it takes the sector periods the
+ * encoder front-end measures and adjust speed accordingly. Also, it beeps and
+ * poweres the robot down when the track gets stuck. To avoid oscillation, we get
+ * the middle value of every three consecutive periods and feed it to a PI
+ * controller that drives the period toward time_target.
+ */
+void left_motor () {
+    unsigned index, count, speed, torque, middle, target, low_speed, high_speed;
+    int error;
+    motors_pid_type pid;
+    uint32_t period;
+    int8_t level;
+    unsigned clocks [3]; /* circular buffer containing last 3 sector periods
+                            (addressed by "index") */
+
+    motors_left_timer.event = event_motors_left;
+
+ stop_motor:
+    left_motor_disable ();
+    motors_left_wheel.torque = 0;
+
+ handle:
+    left_action = motors_action;
+
+    switch (left_action) {
+      case motors_action_forward:
+        low_speed = low_speed_normal;
+        high_speed = high_speed_normal;
+        left_motor_forward ();
+        break;
+      case motors_action_backward:
+        low_speed = low_speed_normal;
+        high_speed = high_speed_normal;
+        left_motor_backward ();
+        break;
+      case motors_action_left:
+        low_speed = low_speed_turn;
+        high_speed = high_speed_turn;
+        left_motor_backward ();
+        break;
+      case motors_action_right:
+        low_speed = low_speed_turn;
+        high_speed = high_speed_turn;
+        left_motor_forward ();
+        break;
+      default:
+        ;
+        /* This includes motors_action_stop */
+        motors_left_wheel.action = left_action;
+        motors_left_wheel.action_time = timer_us ();
+        event_wait (event_motors_left, motors_action != left_action);
+        goto handle;
+    }
+
+    speed = low_speed;
+    left_motor_set (speed);
+    motors_left_wheel.torque = speed;
+    pid_start (&pid, low_speed, high_speed);
+
+    left_motor_enable ();
+    motors_left_wheel.action = left_action;
+    motors_left_wheel.action_time = timer_us ();
+
+    /* Whatever the encoder did while we were stopped does not count */
+    encoder_flush (encoder_left);
+    index = count = 0;
+
+    for (;;) {
+        /* Wait for the next edge */
+        timer_start (&motors_left_timer, timer_us () + sector_maximum_delay * 1000UL);
+        event_wait (event_motors_left, motors_action != left_action ||
+                    encoder_ready (encoder_left) || motors_left_timer.expired);
+        if (motors_action != left_action)
+            goto stop_motor;
+        if (! encoder_ready (encoder_left))
+            do_power_down ("motors: left failed\n");
+        period = encoder_period (encoder_left, &level);
+        motors_left_count ++;
+        motors_left_wheel.time = timer_us ();
+        motors_left_wheel.distance += level > 0 ? 4 : 6;
+        motors_left_wheel.level = level;
+        if (period == 0)
+            /* The first edge, no period yet */
+            continue;
+        clocks [index] = normalize (fixed_us_to_ms (period), level);
+        index = (index + 1) % 3;
+        if (count < 3 && ++ count < 3)
+            /* Getting 3 values */
+            continue;
+
+        middle = get_middle (clocks, index);
+        motors_left_wheel.middle = middle;
+        /* Do not run away from the other wheel when it cannot go faster */
+        target = time_target;
+        if (motors_right_wheel.saturated && motors_right_wheel.middle > target)
+            target = motors_right_wheel.middle;
+        error = (int) middle - (int) target;
+        if (error >= - time_tolerance && error <= time_tolerance)
+            /* Close enough, hold the torque */
+            error = 0;
+        /* Keep up with the other wheel */
+        error += motors_sync (&motors_left_wheel, &motors_right_wheel);
+        if (! motors_slip && (int) (motors_left_count - motors_right_count) > MOTORS_SLIP_COUNT) {
+            motors_slip = 1;
+            print_warning1 ("motors: left slips: %u\n", motors_left_count - motors_right_count);
+        }
+        torque = pid_update (&pid, error);
+        if (torque != speed) {
+            print_debug2 ("motors: left speed: %u %u\n", middle, torque);
+            speed = torque;
+            left_motor_set (speed);
+            motors_left_wheel.torque = speed;
+        }
+        motors_left_wheel.saturated = speed == high_speed;
+    }
+}
+
+/* --- cut --- */
+
+timer_type motors_right_timer;
+motors_action_t right_action;
+
+/**
+ * @brief motor control function.
+ *
+ * Duplicating this function we get two functions:
+ * one for the right motor and one for the left. The function controlled by setting
+ * "motors_action". After the movement started, it takes the sector periods the
+ * encoder front-end measures and adjust speed accordingly. Also, it beeps and
+ * poweres the robot down when the track gets stuck. To avoid oscillation, we get
+ * the middle value of every three consecutive periods and feed it to a PI
+ * controller that drives the period toward time_target.
+ */
+void right_motor () {
+    unsigned index, count, speed, torque, middle, target, low_speed, high_speed;
+    int error;
+    motors_pid_type pid;
+    uint32_t period;
+    int8_t level;
+    unsigned clocks [3]; /* circular buffer containing last 3 sector periods
+                            (addressed by "index") */
+
+    motors_right_timer.event = event_motors_right;
+
+ stop_motor:
+    right_motor_disable ();
+    motors_right_wheel.torque = 0;
+
+ handle:
+    right_action = motors_action;
+
+    switch (right_action) {
+      case motors_action_forward:
+        low_speed = low_speed_normal;
+        high_speed = high_speed_normal;
+        right_motor_forward ();
+        break;
+      case motors_action_backward:
+        low_speed = low_speed_normal;
+        high_speed = high_speed_normal;
+        right_motor_backward ();
+        break;
+      case motors_action_right:
+        low_speed = low_speed_turn;
+        high_speed = high_speed_turn;
+        right_motor_backward ();
+        break;
+      case motors_action_left:
+        low_speed = low_speed_turn;
+        high_speed = high_speed_turn;
+        right_motor_forward ();
+        break;
+      default:
+        ;
+        /* This includes motors_action_stop */
+        motors_right_wheel.action = right_action;
+        motors_right_wheel.action_time = timer_us ();
+        event_wait (event_motors_right, motors_action != right_action);
+        goto handle;
+    }
+
+    speed = low_speed;
+    right_motor_set (speed);
+    motors_right_wheel.torque = speed;
+    pid_start (&pid, low_speed, high_speed);
+
+    right_motor_enable ();
+    motors_right_wheel.action = right_action;
+    motors_right_wheel.action_time = timer_us ();
+
+    /* Whatever the encoder did while we were stopped does not count */
+    encoder_flush (encoder_right);
+    index = count = 0;
+
+    for (;;) {
+        /* Wait for the next edge */
+        timer_start (&motors_right_timer, timer_us () + sector_maximum_delay * 1000UL);
+        event_wait (event_motors_right, motors_action != right_action ||
+                    encoder_ready (encoder_right) || motors_right_timer.expired);
+        if (motors_action != right_action)
+            goto stop_motor;
+        if (! encoder_ready (encoder_right))
+            do_power_down ("motors: right failed\n");
+        period = encoder_period (encoder_right, &level);
+        motors_right_count ++;
+        motors_right_wheel.time = timer_us ();
+        motors_right_wheel.distance += level > 0 ? 4 : 6;
+        motors_right_wheel.level = level;
+        if (period == 0)
+            /* The first edge, no period yet */
+            continue;
+        clocks [index] = normalize (fixed_us_to_ms (period), level);
+        index = (index + 1) % 3;
+        if (count < 3 && ++ count < 3)
+            /* Getting 3 values */
+            continue;
+
+        middle = get_middle (clocks, index);
+        motors_right_wheel.middle = middle;
+        /* Do not run away from the other wheel when it cannot go faster */
+        target = time_target;
+        if (motors_left_wheel.saturated && motors_left_wheel.middle > target)
+            target = motors_left_wheel.middle;
+        error = (int) middle - (int) target;
+        if (error >= - time_tolerance && error <= time_tolerance)
+            /* Close enough, hold the torque */
+            error = 0;
+        /* Keep up with the other wheel */
+        error += motors_sync (&motors_right_wheel, &motors_left_wheel);
+        if (! motors_slip && (int) (motors_right_count - motors_left_count) > MOTORS_SLIP_COUNT) {
+            motors_slip = 1;
+            print_warning1 ("motors: right slips: %u\n", motors_right_count - motors_left_count);
+        }
+        torque = pid_update (&pid, error);
+        if (torque != speed) {
+            print_debug2 ("motors: right speed: %u %u\n", middle, torque);
+            speed = torque;
+            right_motor_set (speed);
+            motors_right_wheel.torque = speed;
+        }
+        motors_right_wheel.saturated = speed == high_speed;
+    }
+}
@@ -22,9 +22,20 @@
 #include "aug-interrupt.h"
 
 #include "timer.h"
+#include "hardware.h"
 
 volatile unsigned clock;
 
+/* Microseconds at the last tick and the tick sequence number */
+static volatile uint32_t timer_base;
+static volatile uint8_t timer_seq;
+
+/* Armed timers in deadline order */
+static timer_type * timer_queue;
+
+/* Timer 2 count of the ADC scan start and whether this tick had it */
+static uint8_t timer_phase, timer_phase_done;
+
 static void timer_init (void) __attribute__ ((constructor));
 static void timer_init (void) {
     clock = 0;
@@ -36,65 +47,191 @@ static void timer_init (void) {
     TIMSK2 |= _BV (OCIE2A);
 }
 
+static void timer_schedule (void);
+
 /* Timer interrupt */
 ISR (TIMER2_COMPA_vect) {
     clock ++;
+    timer_base += timer_tick_us;
+    timer_seq ++;
+    timer_phase_done = 0;
+    timer_schedule ();
+    servo_tick ();
+}
+
+/* Timer queue and ADC scan start */
+ISR (TIMER2_COMPB_vect) {
+    timer_schedule ();
+}
+
+/**
+ * @brief  Reports the time in microseconds
+ *
+ * Resolution is 64us, wrap around time: 2^32 us (~71.5 min).
+ * Does not disable interrupts and works with interrupts disabled
+ * as well. Compare values with timer_due or by subtraction.
+ *
+ * @return  microseconds since the start
+ */
+uint32_t timer_us (void) {
+    uint32_t base;
+    uint8_t seq, count, match;
+
+    /* Retry if the tick interrupt came in the middle */
+    do {
+        seq = timer_seq;
+        base = timer_base;
+        count = TCNT2;
+        match = TIFR2 & _BV (OCF2A);
+    } while (seq != timer_seq);
+
+    /*
+     * A tick the interrupt handler has not seen yet (interrupts are
+     * disabled or it is just about to run). We do not know whether
+     * we took the count before or after the wrap around; a big value
+     * means before, so the time is the start of the new tick.
+     */
+    if (match) {
+        base += timer_tick_us;
+        if (count > clock_divider / 2)
+            count = 0;
+    }
+
+    return base + count * 64U;
+}
+
+/**
+ * @brief  Tells whether a deadline has passed
+ * @param  deadline  time in microseconds (see timer_us)
+ * @return  not 0 if the deadline is now or in the past
+ *
+ * Works across the wrap around as long as the deadline is within
+ * ~35 min from now. Meant for tasks: with interrupts disabled, a tick
+ * may be pending and the deadline may be seen up to a tick late.
+ */
+uint8_t timer_due (uint32_t deadline) {
+    uint8_t seq = timer_seq;
+    uint32_t base = timer_base;
+
+    /* Cheap test first, without touching the timer: not due before
+       the end of the current tick */
+    if (seq == timer_seq && (int32_t) (base + timer_tick_us - deadline) < 0)
+        return 0;
+
+    return (int32_t) (timer_us () - deadline) >= 0;
 }
 
 /**
- * @brief  Reports 64us resolution clock.
+ * @brief  Expires the due timers and sets compare B for the next event
  *
- * Wrap around time: 0.009984000 * 256 / 60 = 2.555904000 (~2.5 sec).
- * Use with pdiff.
+ * Compare B goes off at the ADC scan start and at the deadlines that
+ * fall inside the current tick; the tick interrupt takes care of the
+ * rest. Called with interrupts disabled.
+ */
+static void timer_schedule (void) {
+    uint32_t now, offset;
+    uint8_t count, point;
+
+    for (;;) {
+        now = timer_us ();
+        while (timer_queue != 0 && (int32_t) (now - timer_queue->deadline) >= 0) {
+            timer_queue->expired = 1;
+            event_signal (timer_queue->event);
+            timer_queue = timer_queue->next;
+        }
+
+        count = TCNT2;
+        if (! timer_phase_done && count >= timer_phase) {
+            /* Late or right on time */
+            timer_phase_done = 1;
+            adc_scan ();
+            continue;
+        }
+
+        /* The first of the two, compare B goes off at the end of the step */
+        point = timer_phase_done ? clock_divider + 1 : timer_phase;
+        if (timer_queue != 0) {
+            offset = timer_queue->deadline - timer_base;
+            if (offset < timer_tick_us) {
+                if (offset / 64 <= count)
+                    offset = (count + 1) * 64U;
+                if (offset / 64 < point)
+                    point = offset / 64;
+            }
+        }
+        if (point > clock_divider) {
+            /* Nothing else in this tick */
+            OCR2B = timer_phase;
+            return;
+        }
+        OCR2B = point;
+        if (TCNT2 < point)
+            return;
+        /* Missed it while we were here, take another round */
+    }
+}
+
+/**
+ * @brief  Sets the Timer 2 count at which every tick starts the ADC scan
+ * @param  count  Timer 2 count (0 - clock_divider)
+ */
+void timer_set_phase (uint8_t count) {
+    uint8_t sreg = SREG;
+
+    cli ();
+    timer_phase = count;
+    timer_phase_done = TCNT2 >= count;
+    TIMSK2 |= _BV (OCIE2B);
+    timer_schedule ();
+    SREG = sreg;
+}
+
+/**
+ * @brief  Arms a timer
+ * @param  timer  timer
+ * @param  deadline  time in microseconds (see timer_us)
  *
- * @return  2 byte value: high:low, low: 0-155
+ * "expired" of the timer is cleared and becomes not 0 at the deadline,
+ * right away if the deadline has passed. Arming a timer that is
+ * already armed moves its deadline.
  */
-unsigned pclock (void) {
+void timer_start (timer_type * timer, uint32_t deadline) {
     uint8_t sreg = SREG;
-    unsigned r;
+    timer_type ** p;
 
     cli ();
 
-    r = TCNT2;
+    for (p = & timer_queue; * p != 0; p = & (* p)->next)
+        if (* p == timer) {
+            * p = timer->next;
+            break;
+        }
 
-    /*
-     * The sampled value of TCNT2 is reliable
-     * only if there was no wrap around because
-     * we do not know when we took the sample:
-     * before or after the wrap around.
-     * If the wrap around did happen, 
-     * a good estimation would be clock+1:0
-     * since the time passed after it is really
-     * small.
-     */
+    timer->deadline = deadline;
+    timer->expired = 0;
+    for (p = & timer_queue; * p != 0 && (int32_t) ((* p)->deadline - deadline) <= 0; p = & (* p)->next)
+        ;
+    timer->next = * p;
+    * p = timer;
 
-    if ((TIFR2 & _BV (OCF2A)) == 0)
-        /* No wrap around */
-        r |= clock << 8;
-    else
-        /* Wrap around */
-        r = (clock + 1) << 8;
+    if (timer_queue == timer)
+        timer_schedule ();
 
     SREG = sreg;
-    return r;
 }
 
 /**
- * @brief Calculates time period
- * @param  start  start of period
- * @param  end    end of period
- * @return  number of time units (64us each)
+ * @brief  Reports the time of the last clock tick
+ * @return  time in microseconds (see timer_us)
  */
-unsigned pdiff (unsigned start, unsigned end) {
-    unsigned char h1 = (unsigned char) (start >> 8);
-    unsigned char l1 = (unsigned char) start;
-    unsigned char h2 = (unsigned char) (end >> 8);
-    unsigned char l2 = (unsigned char) end;
-    unsigned char dh = h2 - h1;
-    unsigned char dl = l2 - l1;
-    if (l2 < l1) {
-        dl += clock_divider;
-        dh --;
-    }
-    return (unsigned) dh * clock_divider + dl;
+uint32_t timer_tick (void) {
+    uint32_t base;
+    uint8_t seq;
+
+    do {
+        seq = timer_seq;
+        base = timer_base;
+    } while (seq != timer_seq);
+
+    return base;
 }
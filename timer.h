@@ -21,14 +21,46 @@
  * Notes
  * --------------------------------------------------------
  * + Register increment time step:  1 / 16000000 * 1024 = 0.000064000 (64us)
- * + Internal clock register span:  0-155
- * + Clock tick time:  0.000064000 * 156 = 0.009984000 (~10ms)
- * + Clock wrap around time:  0.009984000 * 65536 / 60 = 10.905190400 (~11 min)
+ * + Internal clock register span:  0-156
+ * + Clock tick time:  0.000064000 * 157 = 0.010048000 (~10ms)
+ * + Clock wrap around time:  0.010048000 * 65536 / 60 = 10.975096832 (~11 min)
+ * + timer_us wrap around time:  2^32 / 1000000 / 60 = 71.582788267 (~71.5 min)
+ *
+ * Use "clock" to wait for the next tick. Measure time and deadlines
+ * with timer_us and timer_due: they stay correct across wrap arounds.
+ *
+ * A task that has to sleep until a given time arms a timer_type with
+ * timer_start and waits for its "expired" flag. The timers are kept in
+ * a queue in deadline order and expired from the Timer 2 interrupts:
+ * compare B goes off at the deadlines inside the current tick, so a
+ * timer expires within one 64us step of its deadline.
  */
+#include <stdint.h>
+
+#include "events.h"
+
 #define clock_divider 156
-#define time_step 0.000064L
+
+/** @brief  Clock tick time in microseconds */
+#define timer_tick_us ((clock_divider + 1) * 64UL)
+
+/**
+ * @brief  Software timer
+ *
+ * Only the "expired" flag is for the user to look at. "event" is
+ * signalled at the expiry as well (see events.h).
+ */
+typedef struct timer_type {
+    uint32_t deadline;
+    volatile uint8_t expired;
+    uint8_t event;
+    struct timer_type * next;
+} timer_type;
 
 extern volatile unsigned clock;
 
-unsigned pclock (void);
-unsigned pdiff (unsigned start, unsigned end);
+uint32_t timer_us (void);
+uint8_t timer_due (uint32_t deadline);
+uint32_t timer_tick (void);
+void timer_start (timer_type * timer, uint32_t deadline);
+void timer_set_phase (uint8_t count);
@@ -18,9 +18,11 @@
  * intact in all distributions and all future versions of this file
  * and the routines within it.
  */
+#include <string.h>
 #include <avr/io.h>
 #include "aug-interrupt.h"
 
+#include "timer.h"
 #include "uart.h"
 
 #define UART_PRESCALLER  (unsigned) (((F_CPU / (UART_BAUDRATE * 8UL))) - 1)
@@ -40,7 +42,8 @@ static void uart_init (void) {
 }
 
 /* This is modified by interrupts */
-volatile unsigned uart_send_put, uart_send_get, uart_receive_put, uart_receive_get;
+volatile uint8_t uart_send_put, uart_send_get, uart_receive_put, uart_receive_get;
+volatile uint32_t uart_receive_time;
 volatile unsigned char uart_send_buf [UART_SEND_BUFFER_SIZE], uart_receive_buf [UART_RECEIVE_BUFFER_SIZE];
 
 /** @brief Activates UART transmission by enable "register empty" interrupt */
@@ -48,20 +51,65 @@ void uart_transmit (void) {
     UCSR0B |= _BV (UDRIE0);
 }
 
+/**
+ * @brief  Places up to \a n bytes into the UART output buffer, does not wait
+ * @return  number of bytes placed, as many as there is room for
+ */
+uint8_t uart_put_bytes (const uint8_t * buf, uint8_t n) {
+    uint8_t put = uart_send_put, room = uart_send_room (), first;
+
+    if (n > room)
+        n = room;
+    if (n == 0)
+        return 0;
+    /* Up to the end of the ring, then from its start */
+    first = n;
+    if (put + n > UART_SEND_BUFFER_SIZE)
+        first = UART_SEND_BUFFER_SIZE - put;
+    memcpy ((uint8_t *) uart_send_buf + put, buf, first);
+    memcpy ((uint8_t *) uart_send_buf, buf + first, n - first);
+    uart_send_put = (put + n) & uart_send_mask;
+    uart_transmit ();
+    return n;
+}
+
+/**
+ * @brief  Takes up to \a n bytes from the UART input buffer, does not wait
+ * @return  number of bytes taken
+ */
+uint8_t uart_get_bytes (uint8_t * buf, uint8_t n) {
+    uint8_t get = uart_receive_get, count = uart_receive_count (), first;
+
+    if (n > count)
+        n = count;
+    if (n == 0)
+        return 0;
+    first = n;
+    if (get + n > UART_RECEIVE_BUFFER_SIZE)
+        first = UART_RECEIVE_BUFFER_SIZE - get;
+    memcpy (buf, (uint8_t *) uart_receive_buf + get, first);
+    memcpy (buf + first, (uint8_t *) uart_receive_buf, n - first);
+    uart_receive_get = (get + n) & uart_receive_mask;
+    return n;
+}
+
 ISR (USART_UDRE_vect) {
     if (uart_send_get != uart_send_put) {
         UDR0 = uart_send_buf [uart_send_get];
-        uart_send_get = (uart_send_get + 1) % UART_SEND_BUFFER_SIZE;
+        uart_send_get = (uart_send_get + 1) & uart_send_mask;
+        event_signal_all (event_uart_send);
         return;
     }
     UCSR0B &= ~_BV (UDRIE0);
 }
 
 ISR (USART_RX_vect) {
-    unsigned uart_receive_next = (uart_receive_put + 1) % UART_RECEIVE_BUFFER_SIZE;
+    uint8_t uart_receive_next = (uart_receive_put + 1) & uart_receive_mask;
     unsigned char b = UDR0;
     if (uart_receive_next != uart_receive_get) {
+        uart_receive_time = timer_us ();
         uart_receive_buf [uart_receive_put] = b;
         uart_receive_put = uart_receive_next;
+        event_signal (event_uart_receive);
     }
 }
@@ -21,11 +21,23 @@
  * Notes
  * -------------------------------------------------------------------
  * We use ring buffers for both sending and receiving. We do not need
- * to disable interrupts while manipulating the buffers. Note that
- * we check the corresponding condition explicitly after SynthOS_wait
- * as there is no guarantee that they are still met when the scheduler
- * gives control back to us.
+ * to disable interrupts while manipulating the buffers. The waiters
+ * sleep on event flags the interrupt handlers signal (see events.h)
+ * and check the buffer condition again when woken up.
+ *
+ * The buffer sizes are powers of two up to 256, so the indices are
+ * single bytes (the interrupt handlers read and write them in one
+ * instruction) and wrap with a mask. One byte of each buffer stays
+ * unused to tell a full buffer from an empty one.
+ *
+ * uart_write and uart_read move a block at a time: they wait once,
+ * copy in at most two pieces (the ring wraps at most once) and move
+ * the index and touch the transmitter once.
  */
+#include <stdint.h>
+
+#include "events.h"
+
 #ifndef UART_BAUDRATE
 #define UART_BAUDRATE             115200
 #endif
@@ -38,10 +50,40 @@
 #define UART_RECEIVE_BUFFER_SIZE      64
 #endif
 
-extern volatile unsigned uart_send_put, uart_send_get, uart_receive_put, uart_receive_get;
+#if (UART_SEND_BUFFER_SIZE & (UART_SEND_BUFFER_SIZE - 1)) != 0 || UART_SEND_BUFFER_SIZE > 256
+#error "UART_SEND_BUFFER_SIZE has to be a power of two up to 256"
+#endif
+
+#if (UART_RECEIVE_BUFFER_SIZE & (UART_RECEIVE_BUFFER_SIZE - 1)) != 0 || UART_RECEIVE_BUFFER_SIZE > 256
+#error "UART_RECEIVE_BUFFER_SIZE has to be a power of two up to 256"
+#endif
+
+#define uart_send_mask    (UART_SEND_BUFFER_SIZE - 1)
+#define uart_receive_mask (UART_RECEIVE_BUFFER_SIZE - 1)
+
+extern volatile uint8_t uart_send_put, uart_send_get, uart_receive_put, uart_receive_get;
+/* Time of the last byte received (see timer_us) */
+extern volatile uint32_t uart_receive_time;
+
 extern volatile unsigned char uart_send_buf [UART_SEND_BUFFER_SIZE], uart_receive_buf [UART_RECEIVE_BUFFER_SIZE];
 
 void uart_transmit (void);
+uint8_t uart_put_bytes (const uint8_t * buf, uint8_t n);
+uint8_t uart_get_bytes (uint8_t * buf, uint8_t n);
+
+/**
+ * @brief  Number of bytes the UART output buffer takes without waiting
+ */
+static inline uint8_t uart_send_room (void) {
+    return (uint8_t) (uart_send_get - uart_send_put - 1) & uart_send_mask;
+}
+
+/**
+ * @brief  Number of bytes in the UART input buffer
+ */
+static inline uint8_t uart_receive_count (void) {
+    return (uint8_t) (uart_receive_put - uart_receive_get) & uart_receive_mask;
+}
 
 /**
  * @brief  Places byte \a b into the UART output buffer with. Waits, if there is no room.
@@ -49,22 +91,25 @@ void uart_transmit (void);
 #define uart_put_byte(b)                                                \
     do {                                                                \
         unsigned char _b = (b);                                         \
-        while (! ((uart_send_put + 1) % UART_SEND_BUFFER_SIZE != uart_send_get)) \
-            SynthOS_wait ((uart_send_put + 1) % UART_SEND_BUFFER_SIZE != uart_send_get); \
+        event_wait_all (event_uart_send, uart_send_room () != 0);       \
         uart_send_buf [uart_send_put] = _b;                             \
-        uart_send_put = (uart_send_put + 1) % UART_SEND_BUFFER_SIZE;    \
+        uart_send_put = (uart_send_put + 1) & uart_send_mask;           \
         uart_transmit ();                                               \
     } while (0)
 
 /**
  * @brief  Places byte \a b into the UART output buffer with. Spins, if there is no room.
+ *
+ * The spin keeps touching the transmitter so that the host build
+ * (where time only moves on register accesses) makes progress too.
  */
 #define uart_put_byte_busy(b)                                           \
     do {                                                                \
         unsigned char _b = (b);                                         \
-        while (! ((uart_send_put + 1) % UART_SEND_BUFFER_SIZE != uart_send_get)) ; \
+        while (uart_send_room () == 0)                                  \
+            uart_transmit ();                                           \
         uart_send_buf [uart_send_put] = _b;                             \
-        uart_send_put = (uart_send_put + 1) % UART_SEND_BUFFER_SIZE;    \
+        uart_send_put = (uart_send_put + 1) & uart_send_mask;           \
         uart_transmit ();                                               \
     } while (0)
 
@@ -73,8 +118,35 @@ void uart_transmit (void);
  */
 #define uart_get_byte(l)                                                \
     do {                                                                \
-        while (!(uart_receive_get != uart_receive_put))                 \
-            SynthOS_wait (uart_receive_get != uart_receive_put);        \
+        event_wait (event_uart_receive, uart_receive_get != uart_receive_put); \
         l = uart_receive_buf [uart_receive_get];                        \
-        uart_receive_get = (uart_receive_get + 1) % UART_RECEIVE_BUFFER_SIZE; \
+        uart_receive_get = (uart_receive_get + 1) & uart_receive_mask;  \
+    } while (0)
+
+/**
+ * @brief  Places \a len bytes from \a buf into the UART output buffer. Waits, if there is no room.
+ *
+ * A block that fits the buffer goes in after a single wait for room
+ * for all of it, so it is not interleaved with other output.
+ */
+#define uart_write(buf, len)                                            \
+    do {                                                                \
+        const uint8_t * _p = (const uint8_t *) (buf);                   \
+        uint8_t _n = (len), _c;                                         \
+        while (_n != 0) {                                               \
+            _c = _n < uart_send_mask ? _n : uart_send_mask;             \
+            event_wait_all (event_uart_send, uart_send_room () >= _c);  \
+            _c = uart_put_bytes (_p, _n);                               \
+            _p += _c;                                                   \
+            _n -= _c;                                                   \
+        }                                                               \
+    } while (0)
+
+/**
+ * @brief  Takes up to \a max bytes from the UART input buffer into \a buf, their number into location \a l. Waits, if there is no data.
+ */
+#define uart_read(l, buf, max)                                          \
+    do {                                                                \
+        event_wait (event_uart_receive, uart_receive_get != uart_receive_put); \
+        l = uart_get_bytes ((buf), (max));                              \
     } while (0)
@@ -21,14 +21,16 @@
 #include "aug-delay.h"
 
 #include "timer.h"
+#include "hardware.h"
 #include "uart.h"
 #include "print.h"
+#include "util.h"
 
 /**
  * @brief  powers the system down
- * @param  msg  message to send to UART
+ * @param  msg  message to send to UART, in flash
  */
-void do_power_down (char * msg) {
+void do_power_down_P (const char * msg) {
 /* 
  * The whole system is going down. We have to stop all external parts.
  * We cannot use the scheduler because other tasks should be inactive now.
@@ -37,11 +39,25 @@ void do_power_down (char * msg) {
     left_motor_disable ();
     right_motor_disable ();
     buzzer_enable ();
-    while (*msg) {
-        if (*msg == '\n')
-            uart_put_byte_busy ('\r');
-        uart_put_byte_busy (*msg ++);
+#if PRINT_BINARY
+    {
+        uint8_t record [print_record_max], n, i;
+
+        n = print_record (record, (uintptr_t) msg, 0, 0, 0);
+        for (i = 0; i < n; i ++)
+            uart_put_byte_busy (record [i]);
+    }
+#else
+    {
+        char c;
+
+        while ((c = pgm_read_byte (msg ++)) != 0) {
+            if (c == '\n')
+                uart_put_byte_busy ('\r');
+            uart_put_byte_busy (c);
+        }
     }
+#endif
     _delay_ms (100); /* Let buzzer and UART finish. */
     buzzer_disable ();
     power_down ();
@@ -18,4 +18,9 @@
  * intact in all distributions and all future versions of this file
  * and the routines within it.
  */
-void do_power_down (char * msg);
+#include "aug-pgmspace.h"
+
+void do_power_down_P (const char * msg);
+
+/** @brief  Powers the system down, \a msg is a literal, kept in flash */
+#define do_power_down(msg) do_power_down_P (PSTR (msg))
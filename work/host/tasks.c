@@ -0,0 +1,27 @@
+/* Generated from project.sop by host/tasks.awk */
+void robot (void);
+void left_motor (void);
+void right_motor (void);
+void command (void);
+void telemetry (void);
+void proximity (void);
+
+void (* const host_tasks []) (void) = {
+    robot,
+    left_motor,
+    right_motor,
+    command,
+    telemetry,
+    proximity,
+    0
+};
+
+const char * const host_task_names [] = {
+    "robot",
+    "left_motor",
+    "right_motor",
+    "command",
+    "telemetry",
+    "proximity",
+    0
+};